@@ -0,0 +1,117 @@
+/**
+ * SimplifierBenchmark.cpp
+ *
+ * Compares the collapse queue of simplifier::modify with the linear scan for the cheapest vertex
+ * on wavy grid meshes of growing size. The scan costs O(n) per collapse and the queue O(log n):
+ * they are even on a few hundred vertices and the scan falls behind quadratically from there.
+ *
+ * Build from the repository root, linking the sources the simplifier depends on:
+ *   g++ -std=c++17 -O2 -Iinclude -Isrc examples/SimplifierBenchmark.cpp src/simplify/simplifier.cpp src/simplify/CornerTable.cpp src/loaders/Loader.cpp src/utils.cpp -o SimplifierBenchmark
+ */
+
+// The loader links against stb_image, main.cpp isn't part of the benchmark
+#define STB_IMAGE_IMPLEMENTATION
+
+#include <chrono>
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <cmath>
+
+#include "./../src/simplify/simplifier.h"
+
+MeshObject createGrid(unsigned int size) {
+  MeshObject mesh = MeshObject(new Mesh());
+
+  for (unsigned int y = 0; y <= size; y++) {
+    for (unsigned int x = 0; x <= size; x++) {
+      float height = std::sin((float) x * 0.37f) * std::cos((float) y * 0.23f) * 0.3f;
+      mesh->position.push_back(glm::vec3((float) x, (float) y, height));
+    }
+  }
+
+  for (unsigned int y = 0; y < size; y++) {
+    for (unsigned int x = 0; x < size; x++) {
+      unsigned int a = y * (size + 1) + x;
+      unsigned int b = a + 1;
+      unsigned int c = a + size + 1;
+      unsigned int d = c + 1;
+
+      Face first;
+      first.positionIndices[0] = a;
+      first.positionIndices[1] = b;
+      first.positionIndices[2] = d;
+
+      Face second;
+      second.positionIndices[0] = a;
+      second.positionIndices[1] = d;
+      second.positionIndices[2] = c;
+
+      mesh->faces.push_back(first);
+      mesh->faces.push_back(second);
+    }
+  }
+
+  return mesh;
+};
+
+MeshObject linearScan(MeshObject &mesh, float maxCost) {
+  simplifier::SimplifyMesh target;
+
+  simplifier::prepare(mesh, target);
+
+  unsigned int next = simplifier::minimumCostEdge(target);
+  while (next != simplifier::noVertex && target.collapseCost[next] < maxCost) {
+    simplifier::collapse(target, next, target.collapseNeighbor[next], nullptr);
+    next = simplifier::minimumCostEdge(target);
+  }
+
+  return simplifier::build(mesh, target);
+};
+
+template <typename Fn>
+double measure(Fn fn) {
+  std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+  fn();
+
+  return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+};
+
+int main(int argc, char** argv) {
+  const float maxCost = 0.5f;
+  const unsigned int sizes[] = { 4, 8, 16, 32, 64, 128, 256 };
+
+  std::cout << std::setw(10) << "vertices" << std::setw(14) << "linear, ms" << std::setw(14) << "queue, ms" << std::setw(10) << "faces" << std::endl;
+
+  for (unsigned int size : sizes) {
+    MeshObject mesh = createGrid(size);
+    MeshObject scanned;
+    MeshObject queued;
+
+    // Small meshes are repeated to get a measurable time
+    unsigned int repeat = std::max(1u, 4096u / (size * size));
+
+    double linearTime = measure([&]() {
+      for (unsigned int i = 0; i < repeat; i++) {
+        scanned = linearScan(mesh, maxCost);
+      }
+    }) / repeat;
+
+    double queueTime = measure([&]() {
+      for (unsigned int i = 0; i < repeat; i++) {
+        queued = simplifier::modify(mesh, maxCost);
+      }
+    }) / repeat;
+
+    std::cout << std::setw(10) << mesh->position.size() << std::setw(14) << std::fixed << std::setprecision(3) << linearTime << std::setw(14) << queueTime << std::setw(10) << queued->faces.size();
+
+    // Both pick the same vertex on equal costs, the results should be the same
+    if (scanned->faces.size() != queued->faces.size()) {
+      std::cout << " (linear: " << scanned->faces.size() << ")";
+    }
+
+    std::cout << std::endl;
+  }
+
+  return 0;
+};
@@ -1,24 +1,64 @@
 #include "App.h"
 
-void App::run() {
+bool App::run() {
   Options &opts = Options::GetInstance();
 
+  if (opts.workers > 0) {
+    Coordinator coordinator;
+    return coordinator.run();
+  }
+
+  Progress &progress = Progress::GetInstance();
+  Progress::installSignalHandler();
+  progress.startReporter(opts.statusInterval, opts.statusFile);
+  progress.setState("importing");
+
   std::string inputFile = utils::normalize(opts.input);
   std::cout << "Importing " << inputFile.c_str() << std::endl;
 
   ObjLoader loader;
+
+  if (opts.box.size() == 6) {
+    BBoxf crop;
+    crop.min = glm::vec3(opts.box[0], opts.box[1], opts.box[2]);
+    crop.max = glm::vec3(opts.box[3], opts.box[4], opts.box[5]);
+    loader.setCrop(crop);
+  }
+
   loader.parse(inputFile.c_str()); 
 
   std::cout << "Import finished" << std::endl;
 
+  size_t faceCount = 0;
+  loader.object->traverse([&](MeshObject mesh){
+    faceCount += mesh->faces.size();
+  });
+
+  if (faceCount == 0 || progress.isCancelled()) {
+    std::cout << (faceCount == 0 ? "Nothing to export" : "Import cancelled") << std::endl;
+    progress.stopReporter();
+    loader.free();
+    return true;
+  }
+
+  progress.estimate(faceCount, opts.limit);
+
   std::string out = utils::normalize(opts.output);
   std::cout << "Output directory: " << out.c_str() << std::endl;
 
 
+  std::shared_ptr<TileWriter> writer = TileWriter::create(opts.writer);
+  if (writer == nullptr) {
+    std::cout << "Writer \"" << opts.writer << "\" isn't available, using \"" << ThreadTileWriter::Type << "\"" << std::endl;
+    writer = ThreadTileWriter::create();
+  }
+
   GLTFExporter exporter;
+  exporter.writer = writer;
 
 
   std::cout << "Splitting..." << std::endl;
+  progress.setState("splitting");
   
 
   float totalError = 0.0f;
@@ -30,64 +70,76 @@ void App::run() {
   unsigned int chunk = 0;
   unsigned int processed = 0;
 
+  // Chunks are saved from the split workers, the tileset and counters are shared
+  std::mutex tilesetMutex;
+
   splitInstance->onSave = [&](GroupObject object, IdGenerator::ID targetId, IdGenerator::ID parentId, unsigned int level, bool indexedGeometry){
       object->computeBoundingBox();
       object->computeGeometricError();
 
+      std::unique_lock<std::mutex> lock(tilesetMutex);
+
       std::string modelDir = std::string("level_") + std::to_string(level);
       std::string modelName = utils::getFileName(object->name) + "_" + std::to_string(chunk);
       std::string modelPath = utils::normalize(
           utils::concatPath("./", utils::concatPath(modelDir, modelName)) + std::string(".") + exporter.format
       );
 
-      std::shared_ptr<Tile> parentTile = tileset.findTileById(parentId);
-      if (parentTile != NULL) {
-          std::shared_ptr<Tile> targetTile = std::make_shared<Tile>();
-          targetTile->id = targetId;
-          targetTile->geometricError = object->geometricError;
-          //   std::cout << "Geom error: " << targetTile->geometricError << std::endl;
-          // targetTile->refine = TileRefine::REPLASE;
+      // The LODs built bottom-up are saved after their children, the tiles are linked in any order
+      std::shared_ptr<Tile> parentTile = tileset.getTile(parentId);
+      std::shared_ptr<Tile> targetTile = tileset.getTile(targetId);
+      targetTile->geometricError = object->geometricError;
+      //   std::cout << "Geom error: " << targetTile->geometricError << std::endl;
+      // targetTile->refine = TileRefine::REPLASE;
 
-          totalError += (float) object->geometricError;
+      totalError += (float) object->geometricError;
 
-          targetTile->content = std::make_shared<TileContent>();
-          targetTile->content->uri = modelPath;
+      targetTile->content = std::make_shared<TileContent>();
+      targetTile->content->uri = modelPath;
 
-          targetTile->boundingVolume = std::make_shared<TileBoundingVolume>();
-          targetTile->boundingVolume->box = std::make_shared<TileBoundingBox>();
+      targetTile->boundingVolume = std::make_shared<TileBoundingVolume>();
+      targetTile->boundingVolume->box = std::make_shared<TileBoundingBox>();
 
-          targetTile->boundingVolume->box->center = object->boundingBox.getCenter();
-          targetTile->boundingVolume->box->xHalf = object->boundingBox.getSize();
-          targetTile->boundingVolume->box->xHalf /= 2.0;
+      targetTile->boundingVolume->box->center = object->boundingBox.getCenter();
+      targetTile->boundingVolume->box->xHalf = object->boundingBox.getSize();
+      targetTile->boundingVolume->box->xHalf /= 2.0;
 
-          targetTile->boundingVolume->box->yHalf = targetTile->boundingVolume->box->xHalf;
-          targetTile->boundingVolume->box->zHalf = targetTile->boundingVolume->box->xHalf;
+      targetTile->boundingVolume->box->yHalf = targetTile->boundingVolume->box->xHalf;
+      targetTile->boundingVolume->box->zHalf = targetTile->boundingVolume->box->xHalf;
 
-          targetTile->boundingVolume->box->xHalf.y = 0.0f;
-          targetTile->boundingVolume->box->xHalf.z = 0.0f;
+      targetTile->boundingVolume->box->xHalf.y = 0.0f;
+      targetTile->boundingVolume->box->xHalf.z = 0.0f;
 
-          targetTile->boundingVolume->box->yHalf.x = 0.0f;
-          targetTile->boundingVolume->box->yHalf.z = 0.0f;
+      targetTile->boundingVolume->box->yHalf.x = 0.0f;
+      targetTile->boundingVolume->box->yHalf.z = 0.0f;
 
-          targetTile->boundingVolume->box->zHalf.x = 0.0f;
-          targetTile->boundingVolume->box->zHalf.y = 0.0f;
+      targetTile->boundingVolume->box->zHalf.x = 0.0f;
+      targetTile->boundingVolume->box->zHalf.y = 0.0f;
 
-          parentTile->children.push_back(targetTile);
-      }
-      
-      exporter.save(utils::concatPath(out, modelDir), modelName, object, indexedGeometry);
+      parentTile->children.push_back(targetTile);
 
       chunk++;
 
       processed++;
+      lock.unlock();
+
+      // Encoding happens on the worker, the finished buffer goes to the writer
+      SchedulerSlot slot(TaskClass::Encode);
+      exporter.save(utils::concatPath(out, modelDir), modelName, object, indexedGeometry);
       // std::cout << "Splitting model " << (processed + 1) << std::endl;
   };
 
-  splitInstance->split(loader.object);
+  // The splitter owns the model from here, every node is released as soon as it is partitioned and decimated
+  splitInstance->split(std::move(loader.object));
   splitInstance->finish();
+
+  // On cancel the running tasks and queued writes are drained, the tileset references only finished tiles
+  progress.setState("writing");
+  writer->finish();
+  writer->report();
+  GeometryTracker::GetInstance().report();
   
-  
-  std::cout << "Exported" << std::endl;
+  std::cout << (progress.isCancelled() ? "Cancelled, saving partial tileset" : "Exported") << std::endl;
 
   std::cout << "Saving JSON" << std::endl;
   // tileset.computeRootGeometricError();
@@ -102,6 +154,10 @@ void App::run() {
   fs.close();
   std::cout << "Saved" << std::endl;
 
+  progress.stopReporter();
+
   loader.free();
+
+  return true;
 };
 
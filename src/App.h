@@ -4,6 +4,7 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <mutex>
 
 #include "Options.h"
 
@@ -15,13 +16,19 @@
 #include "./exporters/ObjExporter.h"
 #include "./exporters/GLTFExporter.h"
 #include "./exporters/B3DMExporter.h"
+#include "./exporters/TileWriter.h"
 
 #include "./utils.h"
 #include "./tiles/Tileset.h"
+#include "./distributed/Coordinator.h"
+#include "./helpers/Progress.h"
+#include "./helpers/Scheduler.h"
+#include "./helpers/GeometryTracker.h"
 
 class App {
   public:
-    static void run();
+    // false when the build failed, a cancel is reported by Progress
+    static bool run();
 };
 
 #endif // __APP_H__
\ No newline at end of file
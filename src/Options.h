@@ -5,6 +5,7 @@
 
 // #include <memory>
 #include <string>
+#include <vector>
 #include <map>
 
 #include "types.h"
@@ -20,6 +21,12 @@ class Options {
     uint32_t grid;
 
     float32_t iso;
+    std::string mesher;
+    bool octree;
+    bool bake;
+    std::string simplifier;
+    uint32_t simplifyChunks;
+    bool hlod;
 
     bool dracoEnabled;
     int textureLevels;
@@ -27,6 +34,23 @@ class Options {
     std::string format;
     std::string algorithm;
 
+    std::string writer;
+    uint32_t ioDepth;
+
+    std::string executable;
+    uint32_t workers;
+    std::string workerCommand;
+    std::vector<float> box;
+
+    uint32_t statusInterval;
+    std::string statusFile;
+
+    uint32_t threads;
+    uint32_t memoryLimit;
+    std::string classThreads;
+    std::string classPriority;
+    std::string schedulerConfig;
+
     static Options& GetInstance() {
       // Allocate with `new` in case Options is not trivially destructible.
       static Options* opts = new Options();
@@ -35,6 +59,7 @@ class Options {
 
     bool valid(int argc, char** argv) {
       this->_options = cxxopts::Options("3dtg", "3d models compiler from various formats to tile format.");
+      this->executable = argv[0];
 
       cxxopts::OptionAdder rootOptions = this->_options.add_options();
 
@@ -43,8 +68,26 @@ class Options {
       rootOptions("l,limit", "Polygons per chunk limit", cxxopts::value(this->limit)->default_value("2048"));
       rootOptions("g,grid", "Grid resolution", cxxopts::value(this->grid)->default_value("64"));
       rootOptions("iso", "Iso level", cxxopts::value(this->iso)->default_value("1.0"));
+      rootOptions("mesher", "Voxel LOD mesher (mc, surfacenets)", cxxopts::value(this->mesher)->default_value("mc"));
+      rootOptions("octree", "Voxelize the model once into an octree shared by all LOD levels", cxxopts::value(this->octree));
+      rootOptions("bake", "Bake a texture atlas for every voxel LOD tile", cxxopts::value(this->bake));
+      rootOptions("simplifier", "LOD simplifier of the regular algorithm (melax, qem)", cxxopts::value(this->simplifier)->default_value("melax"));
+      rootOptions("simplify-chunks", "Lock the tile borders of the regular LODs and simplify them in up to n sub-chunks in parallel, 0 - disabled", cxxopts::value(this->simplifyChunks)->default_value("0"));
+      rootOptions("hlod", "Build the regular LODs bottom-up from the simplified LODs of their children (uses qem)", cxxopts::value(this->hlod));
       rootOptions("compress", "Enable draco compression", cxxopts::value(this->dracoEnabled));
       rootOptions("texlevels", "Count of texture LOD levels", cxxopts::value(this->textureLevels)->default_value("8"));
+      rootOptions("writer", "Tile writer backend (uring, thread, sync)", cxxopts::value(this->writer)->default_value("uring"));
+      rootOptions("io-depth", "Maximum count of outstanding tile writes", cxxopts::value(this->ioDepth)->default_value("64"));
+      rootOptions("workers", "Count of worker processes, enables the coordinator mode", cxxopts::value(this->workers)->default_value("0"));
+      rootOptions("worker-command", "Worker command template, placeholders: {exe} {input} {output} {args} {box} {index}", cxxopts::value(this->workerCommand)->default_value("{exe} {input} {output} {args} --box={box}"));
+      rootOptions("box", "Process only faces with the centroid inside the box: minX,minY,minZ,maxX,maxY,maxZ", cxxopts::value(this->box));
+      rootOptions("status-interval", "Seconds between status lines, 0 disables them", cxxopts::value(this->statusInterval)->default_value("10"));
+      rootOptions("status-file", "Path of the machine-readable JSON status file", cxxopts::value(this->statusFile));
+      rootOptions("threads", "Global cap of worker threads, 0 - hardware concurrency", cxxopts::value(this->threads)->default_value("0"));
+      rootOptions("class-threads", "Thread caps of task classes, e.g. decode=2,io=4 (decode, voxelize, simplify, texture, encode, io)", cxxopts::value(this->classThreads));
+      rootOptions("class-priority", "Priorities of task classes, higher runs first, e.g. voxelize=3,simplify=1", cxxopts::value(this->classPriority));
+      rootOptions("memory-limit", "Resident memory in MB above which coarse LODs run before deep tiles, 0 - disabled", cxxopts::value(this->memoryLimit)->default_value("0"));
+      rootOptions("scheduler-config", "JSON file with scheduler settings", cxxopts::value(this->schedulerConfig));
       // rootOptions("f,format", "Model format to export", cxxopts::value(this->format)->default_value("b3dm"));
 
       /** Algorithm option start */
@@ -109,6 +152,31 @@ class Options {
         return false;
       }
 
+      if (this->box.size() != 0 && this->box.size() != 6) {
+        std::cout << "Box should contain 6 values: minX,minY,minZ,maxX,maxY,maxZ" << std::endl;
+        return false;
+      }
+
+      if (this->mesher != "mc" && this->mesher != "surfacenets") {
+        std::cout << "Mesher \"" << this->mesher << "\" wasn't found, available: mc, surfacenets" << std::endl;
+        return false;
+      }
+
+      if (this->simplifier != "melax" && this->simplifier != "qem") {
+        std::cout << "Simplifier \"" << this->simplifier << "\" wasn't found, available: melax, qem" << std::endl;
+        return false;
+      }
+
+      // The bottom-up LODs are simplified to the polygon limit, which only qem follows
+      if (this->hlod) {
+        if (result.count("simplifier") && this->simplifier != "qem") {
+          std::cout << "--hlod requires --simplifier qem" << std::endl;
+          return false;
+        }
+
+        this->simplifier = "qem";
+      }
+
       if (!this->parseAlgorithm(result)) {
         return false;
       }
@@ -0,0 +1,370 @@
+#include "./Coordinator.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <cfloat>
+#include <algorithm>
+#include <iomanip>
+
+bool Coordinator::scan(const std::string &path, BBoxf &box, std::vector<glm::vec3> &samples, size_t sampleLimit) {
+  std::ifstream input;
+  input.open(path);
+  if (input.fail()) {
+    std::cerr << "Error opeing a model file" << std::endl;
+    return false;
+  }
+
+  box.min = glm::vec3(FLT_MAX);
+  box.max = glm::vec3(-FLT_MAX);
+
+  // Every stride-th vertex is sampled, the stride doubles when the limit is reached
+  size_t stride = 1;
+  size_t count = 0;
+
+  std::string line;
+  while (getline(input, line)) {
+    if (line.size() < 2 || line[0] != 'v' || (line[1] != ' ' && line[1] != '\t')) {
+      continue;
+    }
+
+    char* cursor = &line[1];
+    glm::vec3 position;
+    position.x = strtof(cursor, &cursor);
+    position.y = strtof(cursor, &cursor);
+    position.z = strtof(cursor, &cursor);
+
+    box.extend(position);
+
+    if (count % stride == 0) {
+      if (samples.size() >= sampleLimit) {
+        size_t kept = 0;
+        for (size_t i = 0; i < samples.size(); i += 2) {
+          samples[kept++] = samples[i];
+        }
+        samples.resize(kept);
+        stride *= 2;
+      }
+
+      if (count % stride == 0) {
+        samples.push_back(position);
+      }
+    }
+
+    count++;
+  }
+
+  input.close();
+
+  return count > 0;
+};
+
+void Coordinator::partition(BBoxf box, std::vector<glm::vec3>::iterator begin, std::vector<glm::vec3>::iterator end, unsigned int count, std::vector<BBoxf> &result) {
+  if (count <= 1) {
+    result.push_back(box);
+    return;
+  }
+
+  glm::vec3 size = box.getSize();
+  int axis = 0;
+  if (size.y > size[axis]) axis = 1;
+  if (size.z > size[axis]) axis = 2;
+
+  unsigned int leftCount = count / 2;
+  size_t sampleCount = std::distance(begin, end);
+
+  // Split at the sample quantile so that every worker gets a similar amount of geometry
+  float split = box.min[axis] + size[axis] * (float) leftCount / (float) count;
+  if (sampleCount > 0) {
+    std::vector<glm::vec3>::iterator nth = begin + (sampleCount * leftCount) / count;
+    std::nth_element(begin, nth, end, [&](const glm::vec3 &a, const glm::vec3 &b) {
+      return a[axis] < b[axis];
+    });
+
+    split = std::max(box.min[axis], std::min(box.max[axis], (*nth)[axis]));
+  }
+
+  std::vector<glm::vec3>::iterator middle = std::partition(begin, end, [&](const glm::vec3 &point) {
+    return point[axis] < split;
+  });
+
+  BBoxf left = box;
+  BBoxf right = box;
+  left.max[axis] = split;
+  right.min[axis] = split;
+
+  Coordinator::partition(left, begin, middle, leftCount, result);
+  Coordinator::partition(right, middle, end, count - leftCount, result);
+};
+
+std::string Coordinator::formatBox(BBoxf &box) {
+  // 9 significant digits round-trip a float, so neighbouring workers share the exact same plane
+  std::stringstream ss;
+  ss << std::setprecision(9);
+  ss << box.min.x << "," << box.min.y << "," << box.min.z << ",";
+  ss << box.max.x << "," << box.max.y << "," << box.max.z;
+
+  return ss.str();
+};
+
+std::string Coordinator::workerArguments() {
+  Options &opts = Options::GetInstance();
+
+  std::stringstream ss;
+  ss << "-a " << opts.algorithm;
+  ss << " -f " << opts.format;
+  ss << " -l " << opts.limit;
+  ss << " -g " << opts.grid;
+  ss << " --iso " << opts.iso;
+  ss << " --mesher " << opts.mesher;
+  ss << " --simplifier " << opts.simplifier;
+  ss << " --simplify-chunks " << opts.simplifyChunks;
+  ss << " --texlevels " << opts.textureLevels;
+  ss << " --writer " << opts.writer;
+  ss << " --io-depth " << opts.ioDepth;
+
+  ss << " --status-interval " << opts.statusInterval;
+  ss << " --threads " << opts.threads;
+  ss << " --memory-limit " << opts.memoryLimit;
+
+  if (!opts.classThreads.empty()) {
+    ss << " --class-threads " << opts.classThreads;
+  }
+
+  if (!opts.classPriority.empty()) {
+    ss << " --class-priority " << opts.classPriority;
+  }
+
+  if (!opts.schedulerConfig.empty()) {
+    ss << " --scheduler-config \"" << opts.schedulerConfig << "\"";
+  }
+
+  if (opts.octree) {
+    ss << " --octree";
+  }
+
+  if (opts.bake) {
+    ss << " --bake";
+  }
+
+  if (opts.hlod) {
+    ss << " --hlod";
+  }
+
+  if (opts.dracoEnabled) {
+    ss << " --compress";
+  }
+
+  return ss.str();
+};
+
+std::string Coordinator::buildCommand(WorkerPart &part, const std::string &input) {
+  Options &opts = Options::GetInstance();
+
+  std::map<std::string, std::string> values = {
+    {"{exe}", "\"" + opts.executable + "\""},
+    {"{input}", "\"" + input + "\""},
+    {"{output}", "\"" + part.directory + "\""},
+    {"{args}", this->workerArguments()},
+    {"{box}", Coordinator::formatBox(part.box)},
+    {"{index}", std::to_string(part.index)}
+  };
+
+  std::string command = opts.workerCommand;
+  for (auto const& [key, value] : values) {
+    size_t position = 0;
+    while ((position = command.find(key, position)) != std::string::npos) {
+      command.replace(position, key.length(), value);
+      position += value.length();
+    }
+  }
+
+  return command;
+};
+
+void Coordinator::launch() {
+  std::vector<std::thread> threads;
+
+  for (WorkerPart &part : this->parts) {
+    threads.push_back(std::thread([&part]() {
+      std::cout << "Worker " << part.index << " started: " << part.command << std::endl;
+      part.status = std::system(part.command.c_str());
+      std::cout << "Worker " << part.index << " finished with status " << part.status << std::endl;
+    }));
+  }
+
+  for (std::thread &thread : threads) {
+    thread.join();
+  }
+};
+
+void Coordinator::prefixContent(nlohmann::json &tile, const std::string &prefix) {
+  if (tile.contains("content") && tile["content"].contains("uri")) {
+    std::string uri = tile["content"]["uri"].get<std::string>();
+    if (uri.rfind("./", 0) == 0) {
+      uri = uri.substr(2);
+    }
+
+    tile["content"]["uri"] = prefix + "/" + uri;
+  }
+
+  if (tile.contains("children")) {
+    for (nlohmann::json &child : tile["children"]) {
+      Coordinator::prefixContent(child, prefix);
+    }
+  }
+};
+
+void Coordinator::extendBox(nlohmann::json &tile, BBoxf &box, bool &hasBox) {
+  if (!tile.contains("boundingVolume") || !tile["boundingVolume"].contains("box")) {
+    return;
+  }
+
+  std::vector<float> values = tile["boundingVolume"]["box"].get<std::vector<float>>();
+  if (values.size() != 12) {
+    return;
+  }
+
+  glm::vec3 center(values[0], values[1], values[2]);
+  glm::vec3 extent = glm::abs(glm::vec3(values[3], values[4], values[5])) +
+    glm::abs(glm::vec3(values[6], values[7], values[8])) +
+    glm::abs(glm::vec3(values[9], values[10], values[11]));
+
+  if (!hasBox) {
+    box.min = center - extent;
+    box.max = center + extent;
+    hasBox = true;
+  } else {
+    box.extend(center - extent);
+    box.extend(center + extent);
+  }
+};
+
+bool Coordinator::merge(const std::string &output) {
+  TileAsset asset;
+  nlohmann::json root;
+  std::vector<nlohmann::json> children;
+
+  BBoxf box;
+  bool hasBox = false;
+  bool success = true;
+  double totalError = 0.0;
+
+  for (WorkerPart &part : this->parts) {
+    std::string tilesetPath = utils::concatPath(part.directory, "tileset.json");
+    std::ifstream input(tilesetPath);
+
+    if (input.fail()) {
+      if (part.status != 0) {
+        std::cout << "Worker " << part.index << " has failed, its subtree is missing" << std::endl;
+        success = false;
+      } else {
+        std::cout << "Worker " << part.index << " had no geometry in its box" << std::endl;
+      }
+      continue;
+    }
+
+    nlohmann::json tileset;
+    try {
+      input >> tileset;
+    } catch (nlohmann::json::exception const &exeption) {
+      std::cout << "Can't read " << tilesetPath << ": " << exeption.what() << std::endl;
+      success = false;
+      continue;
+    }
+
+    nlohmann::json partRoot = tileset["root"];
+    Coordinator::prefixContent(partRoot, utils::getFileName(part.directory));
+    Coordinator::extendBox(partRoot, box, hasBox);
+
+    // The same rule App uses for the root, the error of the merged root covers all subtrees
+    totalError += tileset["geometricError"].get<double>();
+
+    children.push_back(partRoot);
+  }
+
+  if (children.size() == 0) {
+    std::cout << "Nothing to merge" << std::endl;
+    return false;
+  }
+
+  glm::vec3 center = box.getCenter();
+  glm::vec3 half = box.getSize() / 2.0f;
+
+  root["boundingVolume"]["box"] = std::vector<float>({
+    center.x, center.y, center.z,
+    half.x, 0.0f, 0.0f,
+    0.0f, half.y, 0.0f,
+    0.0f, 0.0f, half.z
+  });
+  root["geometricError"] = totalError;
+  root["refine"] = TileRefine::REPLASE;
+  root["children"] = children;
+
+  nlohmann::json result;
+  result["asset"] = nlohmann::json::object();
+  result["asset"]["version"] = asset.version;
+  result["geometricError"] = totalError;
+  result["root"] = root;
+
+  std::fstream fs;
+  fs.open(utils::concatPath(output, "tileset.json"), std::fstream::out);
+  fs << result.dump(2);
+  fs.close();
+
+  return success;
+};
+
+bool Coordinator::run() {
+  Options &opts = Options::GetInstance();
+
+  std::string input = utils::normalize(opts.input);
+  std::string output = utils::normalize(opts.output);
+
+  std::cout << "Scanning " << input << std::endl;
+
+  BBoxf box;
+  std::vector<glm::vec3> samples;
+  if (!Coordinator::scan(input, box, samples, 1 << 20)) {
+    std::cout << "No vertices found in " << input << std::endl;
+    return false;
+  }
+
+  // Workers take faces by centroid in a half-open box, the outer max side is pushed out a bit
+  glm::vec3 margin = (glm::abs(box.max) + box.getSize()) * 1e-5f + glm::vec3(1e-3f);
+  box.max += margin;
+
+  std::vector<BBoxf> boxes;
+  Coordinator::partition(box, samples.begin(), samples.end(), opts.workers, boxes);
+  samples.clear();
+
+  if (!utils::folder_exists(output)) {
+    utils::mkdir(output.c_str());
+  }
+
+  for (unsigned int i = 0; i < boxes.size(); i++) {
+    WorkerPart part;
+    part.index = i;
+    part.box = boxes[i];
+    part.directory = utils::concatPath(output, std::string("part_") + std::to_string(i));
+
+    if (!utils::folder_exists(part.directory)) {
+      utils::mkdir(part.directory.c_str());
+    }
+
+    // A tileset left from a previous run must not be merged as this run's result
+    std::remove(utils::concatPath(part.directory, "tileset.json").c_str());
+
+    part.command = this->buildCommand(part, input);
+    this->parts.push_back(part);
+  }
+
+  std::cout << "Launching " << this->parts.size() << " workers" << std::endl;
+  this->launch();
+
+  std::cout << "Merging tilesets" << std::endl;
+  bool merged = this->merge(output);
+
+  std::cout << (merged ? "Saved" : "Saved with errors") << std::endl;
+
+  return merged;
+};
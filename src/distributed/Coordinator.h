@@ -0,0 +1,53 @@
+#ifndef __COORDINATOR_H__
+#define __COORDINATOR_H__
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <thread>
+
+#include <json/json.hpp>
+#include <glm/glm.hpp>
+
+#include "./../Options.h"
+#include "./../utils.h"
+#include "./../loaders/Loader.h"
+#include "./../tiles/TileAsset.h"
+#include "./../tiles/TileStructures.h"
+
+struct WorkerPart {
+  unsigned int index;
+  BBoxf box;
+  std::string directory;
+  std::string command;
+  int status = -1;
+};
+
+/**
+ * Splits the input's bounding box into subtrees, builds every subtree with a separate
+ * 3dtg process (local or started through the user command template) and merges
+ * the resulting tilesets into one.
+ */
+class Coordinator {
+  public:
+    bool run();
+
+    static bool scan(const std::string &path, BBoxf &box, std::vector<glm::vec3> &samples, size_t sampleLimit);
+    static void partition(BBoxf box, std::vector<glm::vec3>::iterator begin, std::vector<glm::vec3>::iterator end, unsigned int count, std::vector<BBoxf> &result);
+    static std::string formatBox(BBoxf &box);
+
+  private:
+    std::vector<WorkerPart> parts;
+
+    std::string workerArguments();
+    std::string buildCommand(WorkerPart &part, const std::string &input);
+    void launch();
+    bool merge(const std::string &output);
+
+    static void prefixContent(nlohmann::json &tile, const std::string &prefix);
+    static void extendBox(nlohmann::json &tile, BBoxf &box, bool &hasBox);
+};
+
+#endif // __COORDINATOR_H__
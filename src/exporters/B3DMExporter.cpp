@@ -9,6 +9,7 @@ std::shared_ptr<Exporter> B3DMExporter::create() {
 void B3DMExporter::save(std::string directory, std::string fileName, GroupObject object, bool indexedGeometry) {
   GLTFExporter exporter;
   exporter.format = this->format;
+  exporter.writer = this->writer;
 
   unsigned int headerByteLength = 28;
   
@@ -26,30 +27,22 @@ void B3DMExporter::save(std::string directory, std::string fileName, GroupObject
     featureTableString += " ";
   }
 
-  exporter.beforeBinWrite = [&](FILE* file, size_t binarySize){
-    fwrite("b3dm", sizeof(char), 4, file);  // magic
+  exporter.beforeBinWrite = [&](WriteBuffer &output, size_t binarySize){
+    output.reserve(headerByteLength + featureTableString.length() + binarySize);
 
-    uint32_t* writeHeader = new uint32_t[1];
+    TileWriter::append(output, "b3dm", 4);  // magic
 
-    writeHeader[0] = 1;
-    fwrite(writeHeader, sizeof(uint32_t), 1, file);  // version
+    uint32_t writeHeader[6];
 
-    writeHeader[0] = headerByteLength + featureTableString.length() + binarySize;
-    fwrite(writeHeader, sizeof(uint32_t), 1, file);  // byteLength - length of entire tile, including header, in bytes
+    writeHeader[0] = 1;  // version
+    writeHeader[1] = headerByteLength + featureTableString.length() + binarySize;  // byteLength - length of entire tile, including header, in bytes
+    writeHeader[2] = featureTableString.size();  // featureTableJSONByteLength - length of feature table JSON section in bytes.
+    writeHeader[3] = 0;  // featureTableBinaryByteLength - length of feature table binary section in bytes.
+    writeHeader[4] = 0;  // batchTableJSONByteLength - length of batch table JSON section in bytes. (0 for basic, no batches)
+    writeHeader[5] = 0;  // batchTableBinaryByteLength - length of batch table binary section in bytes. (0 for basic, no batches)
 
-    writeHeader[0] = featureTableString.size();
-    fwrite(writeHeader, sizeof(uint32_t), 1, file);  // featureTableJSONByteLength - length of feature table JSON section in bytes.
-
-    writeHeader[0] = 0;
-    fwrite(writeHeader, sizeof(uint32_t), 1, file);  // featureTableBinaryByteLength - length of feature table binary section in bytes.
-
-    writeHeader[0] = 0;
-    fwrite(writeHeader, sizeof(uint32_t), 1, file);  // batchTableJSONByteLength - length of batch table JSON section in bytes. (0 for basic, no batches)
-
-    writeHeader[0] = 0;
-    fwrite(writeHeader, sizeof(uint32_t), 1, file);  // batchTableBinaryByteLength - length of batch table binary section in bytes. (0 for basic, no batches)
-
-    fwrite(featureTableString.c_str(), sizeof(char), featureTableString.length(), file);  // featureTableJSONBuffer
+    TileWriter::append(output, writeHeader, sizeof(writeHeader));
+    TileWriter::append(output, featureTableString.c_str(), featureTableString.length());  // featureTableJSONBuffer
   };
 
   exporter.save(directory, fileName, object, indexedGeometry);
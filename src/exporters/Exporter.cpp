@@ -13,3 +13,11 @@ std::shared_ptr<Exporter> Exporter::create(std::string type) {
 void Exporter::addCreator(const std::string type, Exporter::ExporterCreator creator) {
   Exporter::creatorList[type] = creator;
 };
+
+void Exporter::write(std::string path, WriteBuffer buffer) {
+  if (this->writer) {
+    this->writer->write(path, std::move(buffer));
+  } else {
+    TileWriter::writeFile(path, buffer);
+  }
+};
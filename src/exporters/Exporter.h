@@ -12,6 +12,8 @@
 #include "./../loaders/Loader.h"
 #include "./../Options.h"
 
+#include "./TileWriter.h"
+
 class Exporter {
   public:
     virtual void save(std::string directory, std::string fileName, GroupObject object, bool indexedGeometry) = 0;
@@ -21,6 +23,12 @@ class Exporter {
 
     static std::shared_ptr<Exporter> create(std::string type);
     static void addCreator(const std::string type, ExporterCreator creator);
+
+    // Tiles are written synchronously when no writer is set
+    std::shared_ptr<TileWriter> writer;
+
+  protected:
+    void write(std::string path, WriteBuffer buffer);
 };
 
 #endif
\ No newline at end of file
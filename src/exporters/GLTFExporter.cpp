@@ -551,85 +551,77 @@ void GLTFExporter::exportGLTF(GLTF::Asset *asset, GLTF::Options *options, const
     rapidjson::PrettyWriter<rapidjson::StringBuffer> writer(buffer);
     jsonDocument.Accept(writer);
 
-    std::ofstream file(outputPath);
-    if (file.is_open()) {
-      file << buffer.GetString() << std::endl;
-      file.close();
-    } else {
-      std::cout << "ERROR: couldn't write glTF to path '"
-                << outputPath << "'" << std::endl;
-    }
+    std::string prettyString = buffer.GetString();
+    prettyString += "\n";
+
+    WriteBuffer output(prettyString.begin(), prettyString.end());
+    this->write(outputPath, std::move(output));
   } else {
     // std::cout << "Is binary" << std::endl;
-    FILE* file = fopen(outputPath, "wb");
-    if (file != NULL) {
-      int jsonPadding = (4 - (jsonString.length() & 3)) & 3;
-      int binPadding = (4 - (buffer->byteLength & 3)) & 3;
-
-      size_t totalBinSize = 0;
-
-      totalBinSize += sizeof(char) * 4;// glTF magic
-      totalBinSize += sizeof(uint32_t) * 2;// GLB header
-      totalBinSize += sizeof(uint32_t) * 2;// JSON header
-      totalBinSize += sizeof(char) * jsonString.length();// JSON
-      totalBinSize += sizeof(char) * jsonPadding;// JSON padding
-      if (options->version != "1.0") {
-        totalBinSize += sizeof(uint32_t) * 2;// BIN chunk header
-      }
-      totalBinSize += sizeof(unsigned char) * buffer->byteLength;// BIN buffer
-      totalBinSize += sizeof(char) * binPadding;// BIN padding
+    int jsonPadding = (4 - (jsonString.length() & 3)) & 3;
+    int binPadding = (4 - (buffer->byteLength & 3)) & 3;
+
+    size_t totalBinSize = 0;
+
+    totalBinSize += sizeof(char) * 4;// glTF magic
+    totalBinSize += sizeof(uint32_t) * 2;// GLB header
+    totalBinSize += sizeof(uint32_t) * 2;// JSON header
+    totalBinSize += sizeof(char) * jsonString.length();// JSON
+    totalBinSize += sizeof(char) * jsonPadding;// JSON padding
+    if (options->version != "1.0") {
+      totalBinSize += sizeof(uint32_t) * 2;// BIN chunk header
+    }
+    totalBinSize += sizeof(unsigned char) * buffer->byteLength;// BIN buffer
+    totalBinSize += sizeof(char) * binPadding;// BIN padding
 
-      if (this->beforeBinWrite) {
-        this->beforeBinWrite(file, totalBinSize);
-      }
+    // The whole tile is assembled in memory and handed to the writer in one piece
+    WriteBuffer output;
 
-      fwrite("glTF", sizeof(char), 4, file);  // magic
+    if (this->beforeBinWrite) {
+      this->beforeBinWrite(output, totalBinSize);
+    }
 
-      uint32_t* writeHeader = new uint32_t[2];
-      // version
-      if (options->version == "1.0") {
-        writeHeader[0] = 1;
-      } else {
-        writeHeader[0] = 2;
-      }
+    output.reserve(output.size() + totalBinSize);
 
-      writeHeader[1] =
-          GLTFExporter::HEADER_LENGTH +
-          (GLTFExporter::CHUNK_HEADER_LENGTH + jsonString.length() + jsonPadding +
-            buffer->byteLength + binPadding);  // length
-      if (options->version != "1.0") {
-        writeHeader[1] += GLTFExporter::CHUNK_HEADER_LENGTH;
-      }
-      fwrite(writeHeader, sizeof(uint32_t), 2, file);  // GLB header
+    TileWriter::append(output, "glTF", 4);  // magic
 
-      writeHeader[0] =
-          jsonString.length() +
-          jsonPadding;  // 2.0 - chunkLength / 1.0 - contentLength
-      if (options->version == "1.0") {
-        writeHeader[1] = 0;  // 1.0 - contentFormat
-      } else {
-        writeHeader[1] = 0x4E4F534A;  // 2.0 - chunkType JSON
-      }
-      fwrite(writeHeader, sizeof(uint32_t), 2, file);
-      fwrite(jsonString.c_str(), sizeof(char), jsonString.length(), file);
-      for (int i = 0; i < jsonPadding; i++) {
-        fwrite(" ", sizeof(char), 1, file);
-      }
-      if (options->version != "1.0") {
-        writeHeader[0] = buffer->byteLength + binPadding;  // chunkLength
-        writeHeader[1] = 0x004E4942;                       // chunkType BIN
-        fwrite(writeHeader, sizeof(uint32_t), 2, file);
-      }
-      fwrite(buffer->data, sizeof(unsigned char), buffer->byteLength, file);
-      for (int i = 0; i < binPadding; i++) {
-        fwrite("\0", sizeof(char), 1, file);
-      }
-      delete[] writeHeader;
+    uint32_t writeHeader[2];
+    // version
+    if (options->version == "1.0") {
+      writeHeader[0] = 1;
+    } else {
+      writeHeader[0] = 2;
+    }
 
-      fclose(file);
+    writeHeader[1] =
+        GLTFExporter::HEADER_LENGTH +
+        (GLTFExporter::CHUNK_HEADER_LENGTH + jsonString.length() + jsonPadding +
+          buffer->byteLength + binPadding);  // length
+    if (options->version != "1.0") {
+      writeHeader[1] += GLTFExporter::CHUNK_HEADER_LENGTH;
+    }
+    TileWriter::append(output, writeHeader, sizeof(writeHeader));  // GLB header
+
+    writeHeader[0] =
+        jsonString.length() +
+        jsonPadding;  // 2.0 - chunkLength / 1.0 - contentLength
+    if (options->version == "1.0") {
+      writeHeader[1] = 0;  // 1.0 - contentFormat
     } else {
-      std::cout << "ERROR couldn't write binary glTF to path '"
-                << outputPath << "'" << std::endl;
+      writeHeader[1] = 0x4E4F534A;  // 2.0 - chunkType JSON
+    }
+    TileWriter::append(output, writeHeader, sizeof(writeHeader));
+    TileWriter::append(output, jsonString.c_str(), jsonString.length());
+    output.insert(output.end(), jsonPadding, ' ');
+
+    if (options->version != "1.0") {
+      writeHeader[0] = buffer->byteLength + binPadding;  // chunkLength
+      writeHeader[1] = 0x004E4942;                       // chunkType BIN
+      TileWriter::append(output, writeHeader, sizeof(writeHeader));
     }
+    TileWriter::append(output, buffer->data, buffer->byteLength);
+    output.insert(output.end(), binPadding, '\0');
+
+    this->write(outputPath, std::move(output));
   }
 };
@@ -58,7 +58,7 @@ class GLTFExporter : public Exporter {
     void exportGLTF(GLTF::Asset *asset, GLTF::Options *options, const char* outputPath);
     void save(std::string directory, std::string fileName, GroupObject object, bool indexedGeometry);
     
-    std::function<void(FILE* file, size_t binarySize)> beforeBinWrite;
+    std::function<void(WriteBuffer &output, size_t binarySize)> beforeBinWrite;
     struct ImageData
     {
       std::stringstream data = std::stringstream(std::stringstream::binary | std::stringstream::in | std::stringstream::out);
@@ -0,0 +1,502 @@
+#include "./TileWriter.h"
+
+#include <cstring>
+#include <cerrno>
+
+#include "./../Options.h"
+#include "./../helpers/Progress.h"
+#include "./../helpers/Scheduler.h"
+
+#ifdef TILEWRITER_URING
+  #include <linux/io_uring.h>
+  #include <sys/mman.h>
+  #include <sys/syscall.h>
+  #include <fcntl.h>
+  #include <unistd.h>
+#endif
+
+std::map<std::string, TileWriter::WriterCreator> TileWriter::creatorList = {};
+
+std::shared_ptr<TileWriter> TileWriter::create(std::string type) {
+  if (TileWriter::creatorList.count(type) == 0) {
+    return nullptr;
+  }
+
+  return TileWriter::creatorList[type]();
+};
+
+void TileWriter::addCreator(const std::string type, TileWriter::WriterCreator creator) {
+  TileWriter::creatorList[type] = creator;
+};
+
+void TileWriter::append(WriteBuffer &buffer, const void* data, size_t size) {
+  const unsigned char* bytes = static_cast<const unsigned char*>(data);
+  buffer.insert(buffer.end(), bytes, bytes + size);
+};
+
+bool TileWriter::writeFile(const std::string &path, const WriteBuffer &buffer) {
+  FILE* file = fopen(path.c_str(), "wb");
+  if (file == NULL) {
+    std::cout << "ERROR couldn't write file to path '" << path << "'" << std::endl;
+    return false;
+  }
+
+  size_t written = fwrite(buffer.data(), sizeof(unsigned char), buffer.size(), file);
+  fclose(file);
+
+  if (written != buffer.size()) {
+    std::cout << "ERROR couldn't write whole file '" << path << "'" << std::endl;
+    return false;
+  }
+
+  return true;
+};
+
+void TileWriter::onQueued() {
+  std::call_once(this->startFlag, [&]() {
+    this->startTime = std::chrono::steady_clock::now();
+  });
+
+  unsigned int current = ++this->outstanding;
+  unsigned int peak = this->maxOutstanding.load();
+  while (current > peak && !this->maxOutstanding.compare_exchange_weak(peak, current)) {}
+};
+
+void TileWriter::onWritten(size_t size) {
+  Progress::GetInstance().add(ProgressStage::Write, 1, size);
+
+  this->bytesWritten += size;
+  this->filesWritten++;
+  this->outstanding--;
+};
+
+void TileWriter::report() {
+  uint64_t files = this->filesWritten.load();
+  if (files == 0) {
+    return;
+  }
+
+  double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - this->startTime).count();
+  double megabytes = static_cast<double>(this->bytesWritten.load()) / (1024.0 * 1024.0);
+
+  std::cout << "Writer \"" << this->type << "\": " << files << " files, " << megabytes << " MB";
+  if (seconds > 0.0) {
+    std::cout << ", " << (megabytes / seconds) << " MB/s";
+  }
+  std::cout << ", max outstanding writes: " << this->maxOutstanding.load() << std::endl;
+};
+
+/**
+ * Sync writer
+ */
+const std::string SyncTileWriter::Type = "sync";
+std::shared_ptr<TileWriter> SyncTileWriter::create() {
+  std::shared_ptr<TileWriter> writer = std::make_shared<SyncTileWriter>();
+  writer->type = SyncTileWriter::Type;
+  return writer;
+};
+
+void SyncTileWriter::write(std::string path, WriteBuffer buffer) {
+  this->onQueued();
+  TileWriter::writeFile(path, buffer);
+  this->onWritten(buffer.size());
+};
+
+void SyncTileWriter::finish() {};
+
+/**
+ * Thread writer
+ */
+const std::string ThreadTileWriter::Type = "thread";
+std::shared_ptr<TileWriter> ThreadTileWriter::create() {
+  unsigned int depth = std::max(1u, Options::GetInstance().ioDepth);
+
+  unsigned int threads = Scheduler::GetInstance().classThreads(TaskClass::Io);
+
+  std::shared_ptr<TileWriter> writer = std::make_shared<ThreadTileWriter>(std::min(threads, depth), depth);
+  writer->type = ThreadTileWriter::Type;
+  return writer;
+};
+
+ThreadTileWriter::ThreadTileWriter(unsigned int threads, unsigned int depth) : depth(depth) {
+  for (unsigned int i = 0; i < threads; i++) {
+    this->threads.push_back(std::thread(&ThreadTileWriter::process, this));
+  }
+};
+
+ThreadTileWriter::~ThreadTileWriter() {
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->stopping = true;
+  }
+  this->queueChanged.notify_all();
+
+  for (std::thread &thread : this->threads) {
+    thread.join();
+  }
+};
+
+void ThreadTileWriter::write(std::string path, WriteBuffer buffer) {
+  std::shared_ptr<WriteJob> job = std::make_shared<WriteJob>();
+  job->path = std::move(path);
+  job->buffer = std::move(buffer);
+
+  std::unique_lock<std::mutex> lock(this->mutex);
+  // Backpressure, keeps the memory held by pending tiles bounded
+  this->queueChanged.wait(lock, [&]() { return this->outstanding.load() < this->depth; });
+
+  this->onQueued();
+  this->queue.push_back(job);
+  lock.unlock();
+
+  this->queueChanged.notify_all();
+};
+
+void ThreadTileWriter::finish() {
+  std::unique_lock<std::mutex> lock(this->mutex);
+  this->queueChanged.wait(lock, [&]() { return this->outstanding.load() == 0; });
+};
+
+void ThreadTileWriter::process() {
+  while (true) {
+    std::shared_ptr<WriteJob> job;
+
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->queueChanged.wait(lock, [&]() { return this->stopping || !this->queue.empty(); });
+
+      if (this->queue.empty()) {
+        return;
+      }
+
+      job = this->queue.front();
+      this->queue.pop_front();
+    }
+
+    TileWriter::writeFile(job->path, job->buffer);
+
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->onWritten(job->buffer.size());
+    }
+    this->queueChanged.notify_all();
+  }
+};
+
+#ifdef TILEWRITER_URING
+
+/**
+ * io_uring writer
+ */
+const std::string UringTileWriter::Type = "uring";
+std::shared_ptr<TileWriter> UringTileWriter::create() {
+  unsigned int depth = std::max(1u, Options::GetInstance().ioDepth);
+
+  std::shared_ptr<UringTileWriter> writer = std::make_shared<UringTileWriter>(depth);
+  if (!writer->valid()) {
+    std::cout << "io_uring isn't available (" << strerror(writer->setupError) << "), falling back to \"" << ThreadTileWriter::Type << "\" writer" << std::endl;
+    return ThreadTileWriter::create();
+  }
+
+  writer->type = UringTileWriter::Type;
+  return writer;
+};
+
+UringTileWriter::UringTileWriter(unsigned int depth) : depth(depth) {
+  if (this->setup(depth)) {
+    this->thread = std::thread(&UringTileWriter::process, this);
+  }
+};
+
+UringTileWriter::~UringTileWriter() {
+  if (this->thread.joinable()) {
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->stopping = true;
+    }
+    this->queueChanged.notify_all();
+
+    this->thread.join();
+  }
+
+  this->release();
+};
+
+bool UringTileWriter::valid() {
+  return this->ringFd >= 0;
+};
+
+bool UringTileWriter::setup(unsigned int entries) {
+  struct io_uring_params params;
+  memset(&params, 0, sizeof(params));
+
+  int fd = syscall(__NR_io_uring_setup, entries, &params);
+  if (fd < 0) {
+    this->setupError = errno;
+    return false;
+  }
+
+  this->ringFd = fd;
+  // The kernel may round the entries count up
+  this->depth = std::min(this->depth, params.sq_entries);
+
+  this->sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned int);
+  this->cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+
+  bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+  if (singleMap) {
+    this->sqRingSize = std::max(this->sqRingSize, this->cqRingSize);
+    this->cqRingSize = this->sqRingSize;
+  }
+
+  this->sqRing = mmap(0, this->sqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+  if (this->sqRing == MAP_FAILED) {
+    // Saved before the cleanup can change it
+    this->setupError = errno;
+    this->sqRing = nullptr;
+    this->release();
+    return false;
+  }
+
+  if (singleMap) {
+    this->cqRing = this->sqRing;
+  } else {
+    this->cqRing = mmap(0, this->cqRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+    if (this->cqRing == MAP_FAILED) {
+      this->setupError = errno;
+      this->cqRing = nullptr;
+      this->release();
+      return false;
+    }
+  }
+
+  this->sqesSize = params.sq_entries * sizeof(struct io_uring_sqe);
+  void* sqesMap = mmap(0, this->sqesSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+  if (sqesMap == MAP_FAILED) {
+    this->setupError = errno;
+    this->release();
+    return false;
+  }
+  this->sqes = static_cast<struct io_uring_sqe*>(sqesMap);
+
+  char* sq = static_cast<char*>(this->sqRing);
+  this->sqHead = reinterpret_cast<unsigned int*>(sq + params.sq_off.head);
+  this->sqTail = reinterpret_cast<unsigned int*>(sq + params.sq_off.tail);
+  this->sqMask = reinterpret_cast<unsigned int*>(sq + params.sq_off.ring_mask);
+  this->sqArray = reinterpret_cast<unsigned int*>(sq + params.sq_off.array);
+
+  char* cq = static_cast<char*>(this->cqRing);
+  this->cqHead = reinterpret_cast<unsigned int*>(cq + params.cq_off.head);
+  this->cqTail = reinterpret_cast<unsigned int*>(cq + params.cq_off.tail);
+  this->cqMask = reinterpret_cast<unsigned int*>(cq + params.cq_off.ring_mask);
+  this->cqes = reinterpret_cast<struct io_uring_cqe*>(cq + params.cq_off.cqes);
+
+  return true;
+};
+
+void UringTileWriter::release() {
+  if (this->sqes != nullptr) {
+    munmap(this->sqes, this->sqesSize);
+    this->sqes = nullptr;
+  }
+
+  if (this->cqRing != nullptr && this->cqRing != this->sqRing) {
+    munmap(this->cqRing, this->cqRingSize);
+  }
+  this->cqRing = nullptr;
+
+  if (this->sqRing != nullptr) {
+    munmap(this->sqRing, this->sqRingSize);
+    this->sqRing = nullptr;
+  }
+
+  if (this->ringFd >= 0) {
+    close(this->ringFd);
+    this->ringFd = -1;
+  }
+};
+
+void UringTileWriter::write(std::string path, WriteBuffer buffer) {
+  WriteJob* job = new WriteJob();
+  job->path = std::move(path);
+  job->buffer = std::move(buffer);
+
+  std::unique_lock<std::mutex> lock(this->mutex);
+  // Backpressure, keeps the memory held by pending tiles bounded
+  this->queueChanged.wait(lock, [&]() { return this->outstanding.load() < this->depth; });
+
+  this->onQueued();
+  this->queue.push_back(job);
+  lock.unlock();
+
+  this->queueChanged.notify_all();
+};
+
+void UringTileWriter::finish() {
+  std::unique_lock<std::mutex> lock(this->mutex);
+  this->queueChanged.wait(lock, [&]() { return this->outstanding.load() == 0; });
+};
+
+void UringTileWriter::push(WriteJob* job) {
+  unsigned int tail = *this->sqTail;
+  unsigned int index = tail & *this->sqMask;
+
+  size_t left = job->buffer.size() - job->offset;
+
+  job->vector.iov_base = job->buffer.data() + job->offset;
+  job->vector.iov_len = std::min<size_t>(left, 0x7ffff000);
+
+  // WRITEV instead of WRITE keeps the backend working on 5.1+ kernels
+  struct io_uring_sqe* sqe = &this->sqes[index];
+  memset(sqe, 0, sizeof(struct io_uring_sqe));
+  sqe->opcode = IORING_OP_WRITEV;
+  sqe->fd = job->fd;
+  sqe->addr = reinterpret_cast<uint64_t>(&job->vector);
+  sqe->len = 1;
+  sqe->off = job->offset;
+  sqe->user_data = reinterpret_cast<uint64_t>(job);
+
+  this->sqArray[index] = index;
+  __atomic_store_n(this->sqTail, tail + 1, __ATOMIC_RELEASE);
+
+  this->inFlight++;
+  this->submitted.insert(job);
+};
+
+unsigned int UringTileWriter::reap() {
+  unsigned int completed = 0;
+  unsigned int head = *this->cqHead;
+
+  while (head != __atomic_load_n(this->cqTail, __ATOMIC_ACQUIRE)) {
+    struct io_uring_cqe* cqe = &this->cqes[head & *this->cqMask];
+    WriteJob* job = reinterpret_cast<WriteJob*>(cqe->user_data);
+    int result = cqe->res;
+    head++;
+
+    this->inFlight--;
+    this->submitted.erase(job);
+
+    if (result == -EAGAIN || result == -EINTR) {
+      this->push(job);
+    } else if (result < 0) {
+      std::cout << "ERROR couldn't write file to path '" << job->path << "': " << strerror(-result) << std::endl;
+      this->complete(job);
+      completed++;
+    } else {
+      job->offset += result;
+
+      // Short write, the rest goes back to the ring
+      if (job->offset < job->buffer.size() && result > 0) {
+        this->push(job);
+      } else {
+        this->complete(job);
+        completed++;
+      }
+    }
+  }
+
+  __atomic_store_n(this->cqHead, head, __ATOMIC_RELEASE);
+
+  return completed;
+};
+
+void UringTileWriter::complete(WriteJob* job) {
+  if (job->fd >= 0) {
+    close(job->fd);
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->onWritten(job->buffer.size());
+  }
+  this->queueChanged.notify_all();
+
+  delete job;
+};
+
+void UringTileWriter::process() {
+  std::vector<WriteJob*> batch;
+
+  while (true) {
+    {
+      std::unique_lock<std::mutex> lock(this->mutex);
+      if (this->inFlight == 0) {
+        this->queueChanged.wait(lock, [&]() { return this->stopping || !this->queue.empty(); });
+
+        if (this->queue.empty()) {
+          return;
+        }
+      }
+
+      while (!this->queue.empty() && this->inFlight + batch.size() < this->depth) {
+        batch.push_back(this->queue.front());
+        this->queue.pop_front();
+      }
+    }
+
+    for (WriteJob* job : batch) {
+      if (this->failed) {
+        this->writeSync(job);
+        continue;
+      }
+
+      job->fd = open(job->path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+      if (job->fd < 0) {
+        std::cout << "ERROR couldn't write file to path '" << job->path << "': " << strerror(errno) << std::endl;
+        this->complete(job);
+        continue;
+      }
+
+      if (job->buffer.empty()) {
+        this->complete(job);
+        continue;
+      }
+
+      this->push(job);
+    }
+    batch.clear();
+
+    if (this->inFlight == 0) {
+      continue;
+    }
+
+    unsigned int submit = *this->sqTail - __atomic_load_n(this->sqHead, __ATOMIC_ACQUIRE);
+
+    // Submit the whole batch with one syscall and wait for at least one completion
+    int entered = syscall(__NR_io_uring_enter, this->ringFd, submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+    if (entered < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY) {
+      // Nothing in flight would ever be reaped, the loop would spin and finish() would wait forever
+      std::cout << "ERROR io_uring_enter failed: " << strerror(errno) << ", writing the rest synchronously" << std::endl;
+      this->fallback();
+      continue;
+    }
+
+    this->reap();
+  }
+};
+
+void UringTileWriter::writeSync(WriteJob* job) {
+  if (job->fd >= 0) {
+    close(job->fd);
+    job->fd = -1;
+  }
+
+  TileWriter::writeFile(job->path, job->buffer);
+  this->complete(job);
+};
+
+void UringTileWriter::fallback() {
+  this->failed = true;
+  this->release();
+
+  // The submitted jobs are written again from the start, the ring is gone
+  std::vector<WriteJob*> jobs(this->submitted.begin(), this->submitted.end());
+  this->submitted.clear();
+  this->inFlight = 0;
+
+  for (WriteJob* job : jobs) {
+    this->writeSync(job);
+  }
+};
+
+#endif // TILEWRITER_URING
@@ -0,0 +1,181 @@
+#ifndef __TILEWRITER_H__
+#define __TILEWRITER_H__
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <unordered_set>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdint>
+#include <iostream>
+
+#if defined(__linux__) && defined(__has_include)
+  #if __has_include(<linux/io_uring.h>)
+    #define TILEWRITER_URING 1
+    #include <sys/uio.h>
+  #endif
+#endif
+
+typedef std::vector<unsigned char> WriteBuffer;
+
+struct WriteJob {
+  std::string path;
+  WriteBuffer buffer;
+
+  int fd = -1;
+  size_t offset = 0;
+
+#ifdef TILEWRITER_URING
+  struct iovec vector;
+#endif
+};
+
+/**
+ * Writes finished tile buffers to the disk.
+ * Workers hand a buffer over and move on, the writer owns it until it is flushed.
+ */
+class TileWriter {
+  public:
+    virtual ~TileWriter() = default;
+
+    // Takes ownership of the buffer, blocks only if too many writes are outstanding
+    virtual void write(std::string path, WriteBuffer buffer) = 0;
+    // Waits until every queued write is flushed
+    virtual void finish() = 0;
+
+    void report();
+
+    static void append(WriteBuffer &buffer, const void* data, size_t size);
+    static bool writeFile(const std::string &path, const WriteBuffer &buffer);
+
+    typedef std::function<std::shared_ptr<TileWriter>()> WriterCreator;
+    static std::map<std::string, WriterCreator> creatorList;
+
+    static std::shared_ptr<TileWriter> create(std::string type);
+    static void addCreator(const std::string type, WriterCreator creator);
+
+    std::string type;
+
+  protected:
+    std::atomic<uint64_t> bytesWritten{0};
+    std::atomic<uint64_t> filesWritten{0};
+    std::atomic<unsigned int> outstanding{0};
+    std::atomic<unsigned int> maxOutstanding{0};
+
+    std::once_flag startFlag;
+    std::chrono::steady_clock::time_point startTime;
+
+    void onQueued();
+    void onWritten(size_t size);
+};
+
+/**
+ * Writes in the calling thread, the same way tiles were always written.
+ */
+class SyncTileWriter : public TileWriter {
+  public:
+    void write(std::string path, WriteBuffer buffer);
+    void finish();
+
+    static const std::string Type;
+    static std::shared_ptr<TileWriter> create();
+};
+
+/**
+ * Portable fallback, a few threads drain a bounded queue with plain fwrite.
+ */
+class ThreadTileWriter : public TileWriter {
+  public:
+    ThreadTileWriter(unsigned int threads, unsigned int depth);
+    virtual ~ThreadTileWriter();
+
+    void write(std::string path, WriteBuffer buffer);
+    void finish();
+
+    static const std::string Type;
+    static std::shared_ptr<TileWriter> create();
+
+  private:
+    unsigned int depth;
+    bool stopping = false;
+
+    std::deque<std::shared_ptr<WriteJob>> queue;
+    std::vector<std::thread> threads;
+    std::mutex mutex;
+    std::condition_variable queueChanged;
+
+    void process();
+};
+
+#ifdef TILEWRITER_URING
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+/**
+ * Linux io_uring backend (raw syscalls, no liburing needed).
+ * A single submitter thread batches every queued buffer into the submission ring
+ * and reaps completions, short writes are resubmitted.
+ */
+class UringTileWriter : public TileWriter {
+  public:
+    UringTileWriter(unsigned int depth);
+    virtual ~UringTileWriter();
+
+    bool valid();
+    // errno of the failed ring setup
+    int setupError = 0;
+
+    void write(std::string path, WriteBuffer buffer);
+    void finish();
+
+    static const std::string Type;
+    static std::shared_ptr<TileWriter> create();
+
+  private:
+    int ringFd = -1;
+    unsigned int depth;
+    unsigned int inFlight = 0;
+    bool stopping = false;
+    // The ring failed, the jobs are written synchronously
+    bool failed = false;
+
+    unsigned int *sqHead, *sqTail, *sqMask, *sqArray;
+    unsigned int *cqHead, *cqTail, *cqMask;
+    io_uring_sqe *sqes = nullptr;
+    io_uring_cqe *cqes = nullptr;
+
+    void *sqRing = nullptr;
+    void *cqRing = nullptr;
+    size_t sqRingSize = 0;
+    size_t cqRingSize = 0;
+    size_t sqesSize = 0;
+
+    std::deque<WriteJob*> queue;
+    // Jobs submitted to the ring and not reaped yet
+    std::unordered_set<WriteJob*> submitted;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable queueChanged;
+
+    bool setup(unsigned int entries);
+    void release();
+    void process();
+    void push(WriteJob* job);
+    unsigned int reap();
+    void complete(WriteJob* job);
+    void writeSync(WriteJob* job);
+    void fallback();
+};
+
+#endif // TILEWRITER_URING
+
+#endif // __TILEWRITER_H__
@@ -0,0 +1,37 @@
+#include "./GeometryTracker.h"
+
+#include <iostream>
+#include <algorithm>
+
+void GeometryTracker::add(unsigned int depth, uint64_t bytes) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  GeometryUsage &usage = this->depths[depth];
+  usage.live += bytes;
+  usage.peak = std::max(usage.peak, usage.live);
+
+  this->total.live += bytes;
+  this->total.peak = std::max(this->total.peak, this->total.live);
+};
+
+void GeometryTracker::remove(unsigned int depth, uint64_t bytes) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  this->depths[depth].live -= bytes;
+  this->total.live -= bytes;
+};
+
+void GeometryTracker::report() {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  if (this->depths.size() == 0) {
+    return;
+  }
+
+  const double megabyte = 1024.0 * 1024.0;
+
+  std::cout << "Peak live geometry: " << (this->total.peak / megabyte) << " MB" << std::endl;
+  for (auto const& [depth, usage] : this->depths) {
+    std::cout << "  depth " << depth << ": " << (usage.peak / megabyte) << " MB" << std::endl;
+  }
+};
@@ -0,0 +1,63 @@
+#ifndef __GEOMETRYTRACKER_H__
+#define __GEOMETRYTRACKER_H__
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <cstdint>
+
+struct GeometryUsage {
+  uint64_t live = 0;
+  uint64_t peak = 0;
+};
+
+/**
+ * Accounts geometry held by the split tree nodes, per depth and in total.
+ */
+class GeometryTracker {
+  public:
+    static GeometryTracker& GetInstance() {
+      static GeometryTracker* tracker = new GeometryTracker();
+      return *tracker;
+    };
+
+    void add(unsigned int depth, uint64_t bytes);
+    void remove(unsigned int depth, uint64_t bytes);
+    void report();
+
+  private:
+    std::map<unsigned int, GeometryUsage> depths;
+    GeometryUsage total;
+    std::mutex mutex;
+
+    GeometryTracker() = default;
+
+    GeometryTracker(const GeometryTracker&) = delete;
+    GeometryTracker& operator=(const GeometryTracker&) = delete;
+};
+
+/**
+ * Geometry of one node, released when the last owner drops the ticket:
+ * the recursion once the node is partitioned and the LOD task once the node is decimated.
+ */
+class GeometryTicket {
+  public:
+    GeometryTicket(unsigned int depth, uint64_t bytes) : depth(depth), bytes(bytes) {
+      GeometryTracker::GetInstance().add(depth, bytes);
+    };
+
+    ~GeometryTicket() {
+      GeometryTracker::GetInstance().remove(this->depth, this->bytes);
+    };
+
+    GeometryTicket(const GeometryTicket&) = delete;
+    GeometryTicket& operator=(const GeometryTicket&) = delete;
+
+  private:
+    unsigned int depth;
+    uint64_t bytes;
+};
+
+typedef std::shared_ptr<GeometryTicket> GeometryTicketRef;
+
+#endif // __GEOMETRYTRACKER_H__
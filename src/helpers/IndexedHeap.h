@@ -0,0 +1,143 @@
+#ifndef __INDEXEDHEAP_H__
+#define __INDEXEDHEAP_H__
+
+#include <vector>
+#include <cstddef>
+
+/**
+ * Binary min-heap of the items 0..capacity-1 keyed by a value, the position of every item is tracked,
+ * so a key can be changed or an item removed in O(log n) without searching for it.
+ * Equal keys go in item order, the top is the same item a linear scan for the first minimum finds.
+ */
+template <typename Key>
+class IndexedHeap {
+  public:
+    void reset(size_t capacity) {
+      this->heap.clear();
+      this->keys.assign(capacity, Key());
+      this->positions.assign(capacity, Absent);
+    };
+
+    bool empty() const {
+      return this->heap.empty();
+    };
+
+    size_t size() const {
+      return this->heap.size();
+    };
+
+    bool contains(unsigned int item) const {
+      return this->positions[item] != Absent;
+    };
+
+    unsigned int top() const {
+      return this->heap[0];
+    };
+
+    Key topKey() const {
+      return this->keys[this->heap[0]];
+    };
+
+    // Inserts the item or moves it after its key has changed
+    void set(unsigned int item, Key key) {
+      this->keys[item] = key;
+
+      if (this->positions[item] == Absent) {
+        this->positions[item] = this->heap.size();
+        this->heap.push_back(item);
+        this->siftUp(this->positions[item]);
+      } else {
+        this->siftUp(this->positions[item]);
+        this->siftDown(this->positions[item]);
+      }
+    };
+
+    unsigned int pop() {
+      unsigned int item = this->heap[0];
+      this->remove(item);
+
+      return item;
+    };
+
+    void remove(unsigned int item) {
+      size_t position = this->positions[item];
+      if (position == Absent) {
+        return;
+      }
+
+      size_t last = this->heap.size() - 1;
+      this->positions[item] = Absent;
+
+      if (position == last) {
+        this->heap.pop_back();
+        return;
+      }
+
+      // The last item fills the hole and goes up or down from there
+      unsigned int moved = this->heap[last];
+      this->heap.pop_back();
+      this->place(position, moved);
+
+      this->siftUp(position);
+      this->siftDown(this->positions[moved]);
+    };
+
+  private:
+    static constexpr size_t Absent = (size_t) -1;
+
+    std::vector<unsigned int> heap;
+    std::vector<Key> keys;
+    std::vector<size_t> positions;
+
+    bool less(unsigned int a, unsigned int b) const {
+      return this->keys[a] < this->keys[b] || (!(this->keys[b] < this->keys[a]) && a < b);
+    };
+
+    void place(size_t position, unsigned int item) {
+      this->heap[position] = item;
+      this->positions[item] = position;
+    };
+
+    void siftUp(size_t position) {
+      unsigned int item = this->heap[position];
+
+      while (position > 0) {
+        size_t parent = (position - 1) / 2;
+        if (!this->less(item, this->heap[parent])) {
+          break;
+        }
+
+        this->place(position, this->heap[parent]);
+        position = parent;
+      }
+
+      this->place(position, item);
+    };
+
+    void siftDown(size_t position) {
+      unsigned int item = this->heap[position];
+      size_t count = this->heap.size();
+
+      while (true) {
+        size_t child = position * 2 + 1;
+        if (child >= count) {
+          break;
+        }
+
+        if (child + 1 < count && this->less(this->heap[child + 1], this->heap[child])) {
+          child++;
+        }
+
+        if (!this->less(this->heap[child], item)) {
+          break;
+        }
+
+        this->place(position, this->heap[child]);
+        position = child;
+      }
+
+      this->place(position, item);
+    };
+};
+
+#endif // __INDEXEDHEAP_H__
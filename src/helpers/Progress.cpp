@@ -0,0 +1,222 @@
+#include "./Progress.h"
+
+#include <csignal>
+#include <cstdio>
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+
+static void onInterrupt(int) {
+  // The second Ctrl+C kills the process the usual way
+  std::signal(SIGINT, SIG_DFL);
+  Progress::GetInstance().cancel();
+}
+
+void Progress::installSignalHandler() {
+  std::signal(SIGINT, onInterrupt);
+};
+
+bool Progress::isCancelled() {
+  return this->cancelled.load(std::memory_order_relaxed);
+};
+
+void Progress::cancel() {
+  this->cancelled = true;
+};
+
+void Progress::setState(const std::string &state) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+  this->state = state;
+
+  if (state == "splitting") {
+    this->splitTime = std::chrono::steady_clock::now();
+  }
+};
+
+void Progress::setInputSize(uint64_t bytes) {
+  this->inputSize = bytes;
+};
+
+void Progress::estimate(uint64_t polygons, uint32_t limit) {
+  uint64_t levels = 0;
+  uint64_t chunkPolygons = polygons;
+
+  while (limit > 0 && chunkPolygons > limit) {
+    chunkPolygons /= 2;
+    levels++;
+  }
+
+  // LOD tasks of every level see all polygons once, leaves see them one more time
+  this->totalWork = polygons * (levels + 1);
+};
+
+void Progress::add(ProgressStage::Type stage, uint64_t items, uint64_t work) {
+  this->counters[stage].items.fetch_add(items, std::memory_order_relaxed);
+  this->counters[stage].work.fetch_add(work, std::memory_order_relaxed);
+};
+
+float Progress::fraction() {
+  uint64_t total = this->totalWork.load();
+  if (this->finished) {
+    return 1.0f;
+  }
+
+  if (total == 0) {
+    return 0.0f;
+  }
+
+  uint64_t done = this->counters[ProgressStage::Lod].work + this->counters[ProgressStage::Chunk].work;
+
+  // Straddling faces are duplicated by the splits, the estimate is a lower bound
+  return std::min(0.99f, (float) ((double) done / (double) total));
+};
+
+static std::string formatDuration(double seconds) {
+  long total = (long) std::max(0.0, seconds);
+
+  std::stringstream ss;
+  ss << std::setfill('0') << std::setw(2) << (total / 3600) << ":";
+  ss << std::setfill('0') << std::setw(2) << ((total / 60) % 60) << ":";
+  ss << std::setfill('0') << std::setw(2) << (total % 60);
+
+  return ss.str();
+};
+
+nlohmann::json Progress::toJSON() {
+  nlohmann::json result;
+
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  double elapsed = std::chrono::duration<double>(now - this->startTime).count();
+  double splitElapsed = std::chrono::duration<double>(now - this->splitTime).count();
+
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    result["state"] = this->state;
+  }
+
+  float fraction = this->fraction();
+  uint64_t done = this->counters[ProgressStage::Lod].work + this->counters[ProgressStage::Chunk].work;
+  double throughput = (splitElapsed > 0.0) ? (double) done / splitElapsed : 0.0;
+
+  result["progress"] = fraction;
+  result["elapsed"] = elapsed;
+  result["totalWork"] = this->totalWork.load();
+  result["completedWork"] = done;
+  result["polygonsPerSecond"] = throughput;
+  result["cancelled"] = this->isCancelled();
+
+  if (throughput > 0.0 && fraction < 1.0f) {
+    uint64_t total = this->totalWork.load();
+    result["eta"] = (total > done) ? (double) (total - done) / throughput : 0.0;
+  } else {
+    result["eta"] = nullptr;
+  }
+
+  result["stages"] = nlohmann::json::object();
+  for (unsigned int i = 0; i < ProgressStage::Count; i++) {
+    result["stages"][ProgressStage::Names[i]]["items"] = this->counters[i].items.load();
+    result["stages"][ProgressStage::Names[i]]["work"] = this->counters[i].work.load();
+  }
+  result["stages"]["import"]["total"] = this->inputSize.load();
+
+  return result;
+};
+
+std::string Progress::statusLine() {
+  nlohmann::json status = this->toJSON();
+
+  std::stringstream ss;
+  ss << std::fixed << std::setprecision(1);
+  ss << "[" << std::setw(5) << (status["progress"].get<float>() * 100.0f) << "%] " << status["state"].get<std::string>();
+
+  uint64_t inputSize = this->inputSize.load();
+  if (status["state"] == "importing" && inputSize > 0) {
+    ss << " " << (100.0 * (double) this->counters[ProgressStage::Import].work / (double) inputSize) << "% of input";
+  }
+
+  ss << " | lod " << this->counters[ProgressStage::Lod].items;
+  ss << " chunk " << this->counters[ProgressStage::Chunk].items;
+  ss << " write " << this->counters[ProgressStage::Write].items;
+  ss << " (" << ((double) this->counters[ProgressStage::Write].work / (1024.0 * 1024.0)) << " MB)";
+  ss << " | " << (status["polygonsPerSecond"].get<double>() / 1000.0) << "k poly/s";
+  ss << " | elapsed " << formatDuration(status["elapsed"].get<double>());
+
+  if (this->isCancelled()) {
+    if (status["state"] != "cancelled") {
+      ss << " | cancelling";
+    }
+  } else if (!status["eta"].is_null()) {
+    ss << " eta " << formatDuration(status["eta"].get<double>());
+  }
+
+  return ss.str();
+};
+
+void Progress::writeStatusFile() {
+  if (this->statusFile.empty()) {
+    return;
+  }
+
+  // Write and rename, readers never see a half written file
+  std::string temporary = this->statusFile + ".tmp";
+
+  std::ofstream file(temporary);
+  if (!file.is_open()) {
+    return;
+  }
+
+  file << this->toJSON().dump(2);
+  file.close();
+
+  std::rename(temporary.c_str(), this->statusFile.c_str());
+};
+
+void Progress::report() {
+  std::unique_lock<std::mutex> lock(this->mutex);
+
+  while (!this->reporterStopping) {
+    this->reporterWake.wait_for(lock, std::chrono::seconds(this->interval));
+
+    if (this->reporterStopping) {
+      break;
+    }
+
+    lock.unlock();
+    std::cout << this->statusLine() << std::endl;
+    this->writeStatusFile();
+    lock.lock();
+  }
+};
+
+void Progress::startReporter(unsigned int intervalSeconds, const std::string &statusFile) {
+  this->interval = intervalSeconds;
+  this->statusFile = statusFile;
+
+  if (this->interval > 0) {
+    this->reporter = std::thread(&Progress::report, this);
+  }
+
+  this->writeStatusFile();
+};
+
+void Progress::stopReporter() {
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->reporterStopping = true;
+  }
+  this->reporterWake.notify_all();
+
+  if (this->reporter.joinable()) {
+    this->reporter.join();
+  }
+
+  if (!this->isCancelled()) {
+    this->finished = true;
+  }
+  this->setState(this->isCancelled() ? "cancelled" : "finished");
+
+  std::cout << this->statusLine() << std::endl;
+  this->writeStatusFile();
+};
@@ -0,0 +1,90 @@
+#ifndef __PROGRESS_H__
+#define __PROGRESS_H__
+
+#include <string>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+
+#include <json/json.hpp>
+
+namespace ProgressStage {
+  enum Type {
+    Import = 0,// bytes of the input read
+    Lod,// LOD tasks, work is the source polygons of the task
+    Chunk,// leaf chunks, work is the polygons of the chunk
+    Write,// written tiles, work is bytes
+    Count
+  };
+
+  static const char* const Names[Count] = { "import", "lod", "chunk", "write" };
+};
+
+struct ProgressCounter {
+  std::atomic<uint64_t> items{0};
+  std::atomic<uint64_t> work{0};
+};
+
+/**
+ * Build progress shared by the whole process.
+ * Total work is estimated from the polygon count: every split level handles all polygons once.
+ */
+class Progress {
+  public:
+    static Progress& GetInstance() {
+      static Progress* progress = new Progress();
+      return *progress;
+    };
+
+    void setState(const std::string &state);
+    void setInputSize(uint64_t bytes);
+    void estimate(uint64_t polygons, uint32_t limit);
+    void add(ProgressStage::Type stage, uint64_t items, uint64_t work);
+
+    // Cooperative cancellation, workers stop scheduling new work once it is set
+    bool isCancelled();
+    void cancel();
+    static void installSignalHandler();
+
+    void startReporter(unsigned int intervalSeconds, const std::string &statusFile);
+    void stopReporter();
+
+    float fraction();
+    std::string statusLine();
+    nlohmann::json toJSON();
+    void writeStatusFile();
+
+  private:
+    ProgressCounter counters[ProgressStage::Count];
+
+    std::atomic<uint64_t> inputSize{0};
+    std::atomic<uint64_t> totalWork{0};
+    std::atomic<bool> cancelled{false};
+    std::atomic<bool> finished{false};
+
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::time_point splitTime = std::chrono::steady_clock::now();
+
+    std::string state = "starting";
+    std::string statusFile;
+    unsigned int interval = 0;
+
+    std::thread reporter;
+    bool reporterStopping = false;
+    std::mutex mutex;
+    std::condition_variable reporterWake;
+
+    void report();
+
+    Progress() = default;
+
+    Progress(const Progress&) = delete;
+    Progress& operator=(const Progress&) = delete;
+    Progress(Progress&&) = delete;
+    Progress& operator=(Progress&&) = delete;
+};
+
+#endif // __PROGRESS_H__
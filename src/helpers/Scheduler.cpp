@@ -0,0 +1,366 @@
+#include "./Scheduler.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+#include <memory>
+#include <exception>
+
+#include <json/json.hpp>
+
+#if defined(__linux__)
+  #include <unistd.h>
+#endif
+
+bool Scheduler::parseClassName(const std::string &name, TaskClass::Type &taskClass) {
+  for (unsigned int i = 0; i < TaskClass::Count; i++) {
+    if (name == TaskClass::Names[i]) {
+      taskClass = static_cast<TaskClass::Type>(i);
+      return true;
+    }
+  }
+
+  std::cout << "Unknown task class \"" << name << "\", available: decode, voxelize, simplify, texture, encode, io" << std::endl;
+  return false;
+};
+
+bool Scheduler::parseList(const std::string &list, std::function<bool(TaskClass::Type, int)> fn) {
+  std::stringstream ss(list);
+  std::string item;
+
+  while (std::getline(ss, item, ',')) {
+    if (item.empty()) {
+      continue;
+    }
+
+    size_t separator = item.find('=');
+    if (separator == std::string::npos) {
+      std::cout << "Expected class=value, got \"" << item << "\"" << std::endl;
+      return false;
+    }
+
+    TaskClass::Type taskClass;
+    if (!Scheduler::parseClassName(item.substr(0, separator), taskClass)) {
+      return false;
+    }
+
+    if (!fn(taskClass, std::atoi(item.substr(separator + 1).c_str()))) {
+      return false;
+    }
+  }
+
+  return true;
+};
+
+Scheduler::Scheduler() {
+  // Work that finishes a tile goes first, it releases the memory held by the tile
+  this->classes[TaskClass::Io].priority = 5;
+  this->classes[TaskClass::Encode].priority = 4;
+  this->classes[TaskClass::Texture].priority = 3;
+  this->classes[TaskClass::Simplify].priority = 2;
+  this->classes[TaskClass::Voxelize].priority = 2;
+  this->classes[TaskClass::Decode].priority = 1;
+
+  this->classes[TaskClass::Io].threads = 4;
+};
+
+bool Scheduler::configure(unsigned int threads, uint64_t memoryLimit, const std::string &classThreads, const std::string &classPriority, const std::string &configPath) {
+  std::lock_guard<std::mutex> lock(this->mutex);
+
+  this->threadCount = threads;
+  this->memoryLimit = memoryLimit;
+
+  if (!configPath.empty()) {
+    std::ifstream input(configPath);
+    if (input.fail()) {
+      std::cout << "Can't open scheduler config " << configPath << std::endl;
+      return false;
+    }
+
+    nlohmann::json config;
+    try {
+      input >> config;
+    } catch (nlohmann::json::exception const &exeption) {
+      std::cout << "Can't read scheduler config: " << exeption.what() << std::endl;
+      return false;
+    }
+
+    if (config.contains("threads") && threads == 0) {
+      this->threadCount = config["threads"].get<unsigned int>();
+    }
+
+    if (config.contains("memoryLimit") && memoryLimit == 0) {
+      this->memoryLimit = config["memoryLimit"].get<uint64_t>() * 1024 * 1024;
+    }
+
+    if (config.contains("classes")) {
+      for (auto const& [name, settings] : config["classes"].items()) {
+        TaskClass::Type taskClass;
+        if (!Scheduler::parseClassName(name, taskClass)) {
+          return false;
+        }
+
+        if (settings.contains("threads")) {
+          this->classes[taskClass].threads = settings["threads"].get<unsigned int>();
+        }
+        if (settings.contains("priority")) {
+          this->classes[taskClass].priority = settings["priority"].get<int>();
+        }
+      }
+    }
+  }
+
+  // Command line wins over the config file
+  bool valid = Scheduler::parseList(classThreads, [&](TaskClass::Type taskClass, int value) {
+    this->classes[taskClass].threads = std::max(0, value);
+    return true;
+  });
+
+  valid = valid && Scheduler::parseList(classPriority, [&](TaskClass::Type taskClass, int value) {
+    this->classes[taskClass].priority = value;
+    return true;
+  });
+
+  if (this->threadCount == 0) {
+    this->threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  return valid;
+};
+
+unsigned int Scheduler::threads() {
+  if (this->threadCount == 0) {
+    this->threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  return this->threadCount;
+};
+
+unsigned int Scheduler::classThreads(TaskClass::Type taskClass) {
+  unsigned int cap = this->classes[taskClass].threads;
+  return (cap == 0) ? this->threads() : cap;
+};
+
+uint64_t Scheduler::residentMemory() {
+#if defined(__linux__)
+  std::ifstream statm("/proc/self/statm");
+  uint64_t size = 0;
+  uint64_t resident = 0;
+
+  if (statm >> size >> resident) {
+    return resident * (uint64_t) sysconf(_SC_PAGESIZE);
+  }
+#endif
+
+  return 0;
+};
+
+void Scheduler::updateMemory() {
+  if (this->memoryLimit == 0) {
+    return;
+  }
+
+  std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (now - this->memoryChecked < std::chrono::milliseconds(100)) {
+    return;
+  }
+
+  this->memoryChecked = now;
+  this->tight = Scheduler::residentMemory() > this->memoryLimit;
+};
+
+bool Scheduler::memoryTight() {
+  return this->tight.load();
+};
+
+void Scheduler::start() {
+  unsigned int count = this->threads();
+
+  for (unsigned int i = 0; i < count; i++) {
+    this->workers.push_back(std::thread(&Scheduler::process, this));
+  }
+};
+
+void Scheduler::submit(TaskClass::Type taskClass, unsigned int depth, std::function<void()> fn) {
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+
+    if (this->workers.size() == 0) {
+      this->start();
+    }
+
+    ScheduledTask task;
+    task.taskClass = taskClass;
+    task.depth = depth;
+    task.sequence = this->sequence++;
+    task.fn = std::move(fn);
+
+    this->queue.push_back(std::move(task));
+  }
+
+  this->changed.notify_all();
+};
+
+bool Scheduler::canRun(TaskClass::Type taskClass) {
+  return this->classes[taskClass].running < this->classThreads(taskClass);
+};
+
+int Scheduler::pick() {
+  int best = -1;
+  bool tight = this->memoryTight();
+
+  for (unsigned int i = 0; i < this->queue.size(); i++) {
+    ScheduledTask &task = this->queue[i];
+    if (!this->canRun(task.taskClass)) {
+      continue;
+    }
+
+    if (best == -1) {
+      best = i;
+      continue;
+    }
+
+    ScheduledTask &current = this->queue[best];
+    int priority = this->classes[task.taskClass].priority;
+    int currentPriority = this->classes[current.taskClass].priority;
+
+    if (priority != currentPriority) {
+      if (priority > currentPriority) {
+        best = i;
+      }
+    } else if (tight && task.depth != current.depth) {
+      if (task.depth < current.depth) {
+        best = i;
+      }
+    } else if (task.sequence < current.sequence) {
+      best = i;
+    }
+  }
+
+  return best;
+};
+
+void Scheduler::process() {
+  std::unique_lock<std::mutex> lock(this->mutex);
+
+  while (true) {
+    this->updateMemory();
+
+    int index = this->pick();
+    if (index == -1) {
+      this->changed.wait(lock);
+      continue;
+    }
+
+    ScheduledTask task = std::move(this->queue[index]);
+    this->queue.erase(this->queue.begin() + index);
+    this->classes[task.taskClass].running++;
+
+    lock.unlock();
+
+    try {
+      task.fn();
+    } catch (std::exception const &exeption) {
+      std::cerr << "Task of class \"" << TaskClass::Names[task.taskClass] << "\" has failed: " << exeption.what() << std::endl;
+    }
+
+    lock.lock();
+    this->classes[task.taskClass].running--;
+    this->changed.notify_all();
+  }
+};
+
+void Scheduler::acquire(TaskClass::Type taskClass) {
+  std::unique_lock<std::mutex> lock(this->mutex);
+  this->changed.wait(lock, [&]() { return this->canRun(taskClass); });
+  this->classes[taskClass].running++;
+};
+
+void Scheduler::release(TaskClass::Type taskClass) {
+  {
+    std::lock_guard<std::mutex> lock(this->mutex);
+    this->classes[taskClass].running--;
+  }
+  this->changed.notify_all();
+};
+
+void Scheduler::parallel(TaskClass::Type taskClass, size_t count, size_t chunk, std::function<void(size_t, size_t)> fn) {
+  struct ParallelState {
+    std::function<void(size_t, size_t)> fn;
+    size_t count;
+    size_t chunk;
+
+    std::atomic<size_t> next{0};
+    size_t finished = 0;
+
+    // The first exception of fn, the chunks claimed after it are skipped
+    std::exception_ptr error;
+    std::atomic<bool> failed{false};
+
+    std::mutex mutex;
+    std::condition_variable done;
+  };
+
+  if (count == 0) {
+    return;
+  }
+
+  chunk = std::max((size_t) 1, chunk);
+
+  std::shared_ptr<ParallelState> state = std::make_shared<ParallelState>();
+  state->fn = std::move(fn);
+  state->count = count;
+  state->chunk = chunk;
+
+  // Chunks are claimed, a helper that starts after the last one is taken returns at once
+  std::function<void()> run = [state]() {
+    while (true) {
+      size_t begin = state->next.fetch_add(state->chunk);
+      if (begin >= state->count) {
+        return;
+      }
+
+      size_t end = std::min(state->count, begin + state->chunk);
+      std::exception_ptr error;
+
+      if (!state->failed) {
+        try {
+          state->fn(begin, end);
+        } catch (...) {
+          error = std::current_exception();
+        }
+      }
+
+      // A failed chunk is still counted, the caller waits for every helper before fn goes out of scope
+      std::lock_guard<std::mutex> lock(state->mutex);
+      if (error && !state->error) {
+        state->error = error;
+        state->failed = true;
+      }
+
+      state->finished += end - begin;
+      if (state->finished == state->count) {
+        state->done.notify_all();
+      }
+    }
+  };
+
+  size_t chunks = (count + chunk - 1) / chunk;
+  size_t helpers = std::min(chunks - 1, (size_t) this->classThreads(taskClass) - 1);
+
+  // Helpers finish a task that already holds memory, depth 0 puts them first when the memory is tight
+  for (size_t i = 0; i < helpers; i++) {
+    this->submit(taskClass, 0, run);
+  }
+
+  // The caller never waits for a helper that hasn't started, so all workers being busy can't deadlock it
+  run();
+
+  std::unique_lock<std::mutex> lock(state->mutex);
+  state->done.wait(lock, [&]() { return state->finished == state->count; });
+
+  if (state->error) {
+    std::rethrow_exception(state->error);
+  }
+};
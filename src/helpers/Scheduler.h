@@ -0,0 +1,123 @@
+#ifndef __SCHEDULER_H__
+#define __SCHEDULER_H__
+
+#include <string>
+#include <vector>
+#include <map>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+#include <cstdint>
+
+namespace TaskClass {
+  enum Type {
+    Decode = 0,// texture decoding on import
+    Voxelize,// voxel LOD tasks
+    Simplify,// regular LOD tasks
+    Texture,// texture LOD resizing
+    Encode,// tile encoding
+    Io,// tile writing
+    Count
+  };
+
+  static const char* const Names[Count] = { "decode", "voxelize", "simplify", "texture", "encode", "io" };
+};
+
+struct TaskClassSettings {
+  unsigned int threads = 0;// 0 - limited only by the global cap
+  int priority = 0;// higher runs first
+
+  unsigned int running = 0;
+};
+
+struct ScheduledTask {
+  TaskClass::Type taskClass;
+  unsigned int depth;
+  uint64_t sequence;
+  std::function<void()> fn;
+};
+
+/**
+ * Persistent worker threads shared by every pool of the process.
+ * Tasks are picked by class priority, a class never runs more tasks than its cap.
+ * When the resident memory is above the limit, shallow (coarse LOD) tasks go before deep ones.
+ */
+class Scheduler {
+  public:
+    static Scheduler& GetInstance() {
+      static Scheduler* scheduler = new Scheduler();
+      return *scheduler;
+    };
+
+    bool configure(unsigned int threads, uint64_t memoryLimit, const std::string &classThreads, const std::string &classPriority, const std::string &configPath);
+
+    void submit(TaskClass::Type taskClass, unsigned int depth, std::function<void()> fn);
+
+    // Gates work that runs inside another task (encoding, texture LOD) by the class cap
+    void acquire(TaskClass::Type taskClass);
+    void release(TaskClass::Type taskClass);
+
+    // Runs fn over [0, count) in chunks on idle workers and the calling thread, safe to call from inside a task
+    // Returns once every chunk is done, the first exception of fn is rethrown on the caller
+    void parallel(TaskClass::Type taskClass, size_t count, size_t chunk, std::function<void(size_t, size_t)> fn);
+
+    unsigned int threads();
+    unsigned int classThreads(TaskClass::Type taskClass);
+    bool memoryTight();
+
+    static uint64_t residentMemory();
+    static bool parseClassName(const std::string &name, TaskClass::Type &taskClass);
+
+  private:
+    unsigned int threadCount = 0;
+    uint64_t memoryLimit = 0;
+
+    TaskClassSettings classes[TaskClass::Count];
+
+    std::vector<ScheduledTask> queue;
+    std::vector<std::thread> workers;
+    uint64_t sequence = 0;
+
+    std::atomic<bool> tight{false};
+    std::chrono::steady_clock::time_point memoryChecked;
+
+    std::mutex mutex;
+    std::condition_variable changed;
+
+    void start();
+    void process();
+    bool canRun(TaskClass::Type taskClass);
+    int pick();
+    void updateMemory();
+
+    static bool parseList(const std::string &list, std::function<bool(TaskClass::Type, int)> fn);
+
+    Scheduler();
+
+    Scheduler(const Scheduler&) = delete;
+    Scheduler& operator=(const Scheduler&) = delete;
+    Scheduler(Scheduler&&) = delete;
+    Scheduler& operator=(Scheduler&&) = delete;
+};
+
+class SchedulerSlot {
+  public:
+    SchedulerSlot(TaskClass::Type taskClass) : taskClass(taskClass) {
+      Scheduler::GetInstance().acquire(taskClass);
+    };
+
+    ~SchedulerSlot() {
+      Scheduler::GetInstance().release(this->taskClass);
+    };
+
+    SchedulerSlot(const SchedulerSlot&) = delete;
+    SchedulerSlot& operator=(const SchedulerSlot&) = delete;
+
+  private:
+    TaskClass::Type taskClass;
+};
+
+#endif // __SCHEDULER_H__
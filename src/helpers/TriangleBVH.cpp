@@ -0,0 +1,185 @@
+#include "./TriangleBVH.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "./../loaders/Loader.h"
+
+void TriangleBVH::add(glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+  this->triangles.push_back(this->triangles.size());
+  this->vertices.push_back(a);
+  this->vertices.push_back(b);
+  this->vertices.push_back(c);
+};
+
+void TriangleBVH::clear() {
+  this->vertices.clear();
+  this->triangles.clear();
+  this->nodes.clear();
+};
+
+unsigned int TriangleBVH::size() {
+  return this->triangles.size();
+};
+
+void TriangleBVH::build() {
+  this->nodes.clear();
+
+  unsigned int count = this->triangles.size();
+  if (count == 0) {
+    return;
+  }
+
+  std::vector<glm::vec3> centroids(count);
+  for (unsigned int i = 0; i < count; i++) {
+    centroids[i] = (this->vertices[i * 3] + this->vertices[i * 3 + 1] + this->vertices[i * 3 + 2]) / 3.0f;
+  }
+
+  std::vector<unsigned int> order(count);
+  for (unsigned int i = 0; i < count; i++) {
+    order[i] = i;
+  }
+
+  this->nodes.reserve(2 * count / TriangleBVH::LeafSize + 1);
+  this->nodes.emplace_back();
+  this->nodes[0].start = 0;
+  this->nodes[0].count = count;
+
+  // Nodes are split in place, children are appended in pairs
+  std::vector<unsigned int> stack = { 0 };
+
+  while (!stack.empty()) {
+    unsigned int index = stack.back();
+    stack.pop_back();
+
+    unsigned int start = this->nodes[index].start;
+    unsigned int size = this->nodes[index].count;
+
+    glm::vec3 min(FLT_MAX);
+    glm::vec3 max(-FLT_MAX);
+    glm::vec3 centroidMin(FLT_MAX);
+    glm::vec3 centroidMax(-FLT_MAX);
+
+    for (unsigned int i = start; i < start + size; i++) {
+      for (unsigned int k = 0; k < 3; k++) {
+        min = glm::min(min, this->vertices[order[i] * 3 + k]);
+        max = glm::max(max, this->vertices[order[i] * 3 + k]);
+      }
+
+      centroidMin = glm::min(centroidMin, centroids[order[i]]);
+      centroidMax = glm::max(centroidMax, centroids[order[i]]);
+    }
+
+    this->nodes[index].min = min;
+    this->nodes[index].max = max;
+
+    if (size <= TriangleBVH::LeafSize) {
+      continue;
+    }
+
+    glm::vec3 extent = centroidMax - centroidMin;
+    int axis = 0;
+    if (extent.y > extent[axis]) axis = 1;
+    if (extent.z > extent[axis]) axis = 2;
+
+    // Median split, the tree stays balanced on uneven meshes too
+    unsigned int half = size / 2;
+    std::nth_element(order.begin() + start, order.begin() + start + half, order.begin() + start + size, [&](unsigned int a, unsigned int b) {
+      return centroids[a][axis] < centroids[b][axis];
+    });
+
+    unsigned int left = this->nodes.size();
+
+    this->nodes.emplace_back();
+    this->nodes[left].start = start;
+    this->nodes[left].count = half;
+
+    this->nodes.emplace_back();
+    this->nodes[left + 1].start = start + half;
+    this->nodes[left + 1].count = size - half;
+
+    this->nodes[index].start = left;
+    this->nodes[index].count = 0;
+
+    stack.push_back(left);
+    stack.push_back(left + 1);
+  }
+
+  // Leaves address the triangles directly, so the corners are reordered to the leaf order
+  std::vector<glm::vec3> vertices(count * 3);
+  std::vector<unsigned int> triangles(count);
+  for (unsigned int i = 0; i < count; i++) {
+    triangles[i] = this->triangles[order[i]];
+    for (unsigned int k = 0; k < 3; k++) {
+      vertices[i * 3 + k] = this->vertices[order[i] * 3 + k];
+    }
+  }
+
+  this->vertices.swap(vertices);
+  this->triangles.swap(triangles);
+};
+
+float TriangleBVH::boxDistance(const TriangleBVHNode &node, glm::vec3 p) {
+  glm::vec3 d = glm::max(glm::vec3(0.0f), glm::max(node.min - p, p - node.max));
+  return glm::dot(d, d);
+};
+
+bool TriangleBVH::closestPoint(glm::vec3 p, TriangleBVHHit &hit) const {
+  hit.found = false;
+  hit.distance = FLT_MAX;
+
+  if (this->nodes.empty()) {
+    return false;
+  }
+
+  // Squared distances until the end
+  float best = FLT_MAX;
+
+  unsigned int stack[64];
+  unsigned int stackSize = 0;
+  stack[stackSize++] = 0;
+
+  while (stackSize > 0) {
+    const TriangleBVHNode &node = this->nodes[stack[--stackSize]];
+
+    if (TriangleBVH::boxDistance(node, p) > best) {
+      continue;
+    }
+
+    if (node.count > 0) {
+      for (unsigned int i = node.start; i < node.start + node.count; i++) {
+        Vec3Result closest = math::clothestTrianglePoint(p, this->vertices[i * 3], this->vertices[i * 3 + 1], this->vertices[i * 3 + 2]);
+        glm::vec3 d = closest.data - p;
+        float distance = glm::dot(d, d);
+
+        if (distance < best) {
+          best = distance;
+          hit.point = closest.data;
+          hit.barycentric = closest.uv;
+          hit.triangle = this->triangles[i];
+          hit.found = true;
+        }
+      }
+
+      continue;
+    }
+
+    // The nearer child is visited first, it usually makes the farther one fail the box test
+    float left = TriangleBVH::boxDistance(this->nodes[node.start], p);
+    float right = TriangleBVH::boxDistance(this->nodes[node.start + 1], p);
+
+    if (left <= right) {
+      stack[stackSize++] = node.start + 1;
+      stack[stackSize++] = node.start;
+    } else {
+      stack[stackSize++] = node.start;
+      stack[stackSize++] = node.start + 1;
+    }
+  }
+
+  if (hit.found) {
+    hit.distance = std::sqrt(best);
+  }
+
+  return hit.found;
+};
@@ -0,0 +1,53 @@
+#ifndef __TRIANGLEBVH_H__
+#define __TRIANGLEBVH_H__
+
+#include <vector>
+#include <cfloat>
+#include <glm/glm.hpp>
+
+struct TriangleBVHNode {
+  glm::vec3 min;
+  // Leaf: the first triangle, inner node: the left child, the right one follows it
+  unsigned int start = 0;
+  glm::vec3 max;
+  // 0 - inner node
+  unsigned int count = 0;
+};
+
+struct TriangleBVHHit {
+  glm::vec3 point;
+  // Weights of the third and the second corner, as math::clothestTrianglePoint gives them
+  glm::vec2 barycentric;
+  float distance = FLT_MAX;
+  // Index the triangle was added with
+  unsigned int triangle = 0;
+  bool found = false;
+};
+
+/**
+ * Bounding volume hierarchy over a triangle soup for closest point queries.
+ * Triangles are added, then build() sorts them into leaves. Queries are read only and can run from many threads.
+ */
+class TriangleBVH {
+  public:
+    static const unsigned int LeafSize = 4;
+
+    void add(glm::vec3 a, glm::vec3 b, glm::vec3 c);
+    void build();
+    void clear();
+
+    unsigned int size();
+
+    bool closestPoint(glm::vec3 p, TriangleBVHHit &hit) const;
+
+  private:
+    // 3 corners per triangle, in leaf order after build()
+    std::vector<glm::vec3> vertices;
+    // Index the triangle was added with, in leaf order
+    std::vector<unsigned int> triangles;
+    std::vector<TriangleBVHNode> nodes;
+
+    static float boxDistance(const TriangleBVHNode &node, glm::vec3 p);
+};
+
+#endif // __TRIANGLEBVH_H__
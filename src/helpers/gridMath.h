@@ -0,0 +1,100 @@
+#ifndef __GRIDMATH_H__
+#define __GRIDMATH_H__
+
+#include <cstddef>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#if defined(__SSE__) || defined(_M_X64)
+  #include <xmmintrin.h>
+#else
+  #define GRIDMATH_SCALAR
+#endif
+
+/**
+ * Morton (Z-order) keys interleave the bits of the cell coordinates, 21 bits per axis.
+ * Cells close in space get close keys, so sorted keys and key-ordered storage keep neighbours together.
+ */
+inline uint64_t mortonSpread(uint64_t value) {
+  value &= 0x1FFFFF;
+  value = (value | (value << 32)) & 0x1F00000000FFFFull;
+  value = (value | (value << 16)) & 0x1F0000FF0000FFull;
+  value = (value | (value << 8)) & 0x100F00F00F00F00Full;
+  value = (value | (value << 4)) & 0x10C30C30C30C30C3ull;
+  value = (value | (value << 2)) & 0x1249249249249249ull;
+
+  return value;
+};
+
+inline uint64_t mortonCompact(uint64_t value) {
+  value &= 0x1249249249249249ull;
+  value = (value | (value >> 2)) & 0x10C30C30C30C30C3ull;
+  value = (value | (value >> 4)) & 0x100F00F00F00F00Full;
+  value = (value | (value >> 8)) & 0x1F0000FF0000FFull;
+  value = (value | (value >> 16)) & 0x1F00000000FFFFull;
+  value = (value | (value >> 32)) & 0x1FFFFF;
+
+  return value;
+};
+
+inline uint64_t mortonKey(unsigned int x, unsigned int y, unsigned int z) {
+  return mortonSpread(x) | (mortonSpread(y) << 1) | (mortonSpread(z) << 2);
+};
+
+inline glm::ivec3 mortonCell(uint64_t key) {
+  return glm::ivec3((int) mortonCompact(key), (int) mortonCompact(key >> 1), (int) mortonCompact(key >> 2));
+};
+
+/**
+ * Conversions between world and grid space, where a cell is a unit cube.
+ * The scale is the reciprocal of the cell size, so a point costs a subtraction and a multiplication.
+ */
+namespace GridMath {
+  // floor() for the range of the grid coordinates, without the rounding mode switch of std::floor
+  inline int fastFloor(float value) {
+    int truncated = (int) value;
+    return truncated - (value < (float) truncated ? 1 : 0);
+  };
+
+  inline glm::ivec3 fastFloor(glm::vec3 value) {
+    return glm::ivec3(fastFloor(value.x), fastFloor(value.y), fastFloor(value.z));
+  };
+
+  /**
+   * (points[i] - offset) * scale for the whole array, result may be the same array.
+   * Four points are 12 floats, that is 3 registers with the offset and the scale rotated to match.
+   */
+  inline void toGridSpace(glm::vec3 offset, glm::vec3 scale, const glm::vec3* points, glm::vec3* result, size_t count) {
+    size_t i = 0;
+
+#if !defined(GRIDMATH_SCALAR)
+    static_assert(sizeof(glm::vec3) == 3 * sizeof(float), "glm::vec3 should be packed");
+
+    const __m128 offset0 = _mm_setr_ps(offset.x, offset.y, offset.z, offset.x);
+    const __m128 offset1 = _mm_setr_ps(offset.y, offset.z, offset.x, offset.y);
+    const __m128 offset2 = _mm_setr_ps(offset.z, offset.x, offset.y, offset.z);
+    const __m128 scale0 = _mm_setr_ps(scale.x, scale.y, scale.z, scale.x);
+    const __m128 scale1 = _mm_setr_ps(scale.y, scale.z, scale.x, scale.y);
+    const __m128 scale2 = _mm_setr_ps(scale.z, scale.x, scale.y, scale.z);
+
+    for (; i + 4 <= count; i += 4) {
+      const float* source = &points[i].x;
+      float* target = &result[i].x;
+
+      __m128 v0 = _mm_loadu_ps(source);
+      __m128 v1 = _mm_loadu_ps(source + 4);
+      __m128 v2 = _mm_loadu_ps(source + 8);
+
+      _mm_storeu_ps(target, _mm_mul_ps(_mm_sub_ps(v0, offset0), scale0));
+      _mm_storeu_ps(target + 4, _mm_mul_ps(_mm_sub_ps(v1, offset1), scale1));
+      _mm_storeu_ps(target + 8, _mm_mul_ps(_mm_sub_ps(v2, offset2), scale2));
+    }
+#endif
+
+    for (; i < count; i++) {
+      result[i] = (points[i] - offset) * scale;
+    }
+  };
+}
+
+#endif // __GRIDMATH_H__
@@ -0,0 +1,161 @@
+#ifndef __TRIANGLEBOXSIMD_H__
+#define __TRIANGLEBOXSIMD_H__
+
+#include <cmath>
+#include <glm/glm.hpp>
+
+#if defined(__AVX__)
+  #include <immintrin.h>
+  #define TRIANGLEBOX_SIMD_WIDTH 8
+#elif defined(__SSE__) || defined(_M_X64)
+  #include <xmmintrin.h>
+  #define TRIANGLEBOX_SIMD_WIDTH 4
+#else
+  #define TRIANGLEBOX_SIMD_WIDTH 4
+  #define TRIANGLEBOX_SCALAR
+#endif
+
+/**
+ * Separating axis test of one triangle against a batch of equal boxes.
+ * Everything that depends only on the triangle is projected once in prepare(),
+ * a box then costs one dot product and two compares per axis, done for 4 (SSE) or 8 (AVX) boxes at once.
+ */
+namespace TriangleBoxSimd {
+  static const unsigned int Width = TRIANGLEBOX_SIMD_WIDTH;
+  // 3 box normals, the triangle normal and 9 edge x box axis products
+  static const unsigned int MaxAxes = 13;
+
+  struct Triangle {
+    float axisX[MaxAxes];
+    float axisY[MaxAxes];
+    float axisZ[MaxAxes];
+    float minProjection[MaxAxes];
+    float maxProjection[MaxAxes];
+    // Projected half size of the box
+    float radius[MaxAxes];
+    unsigned int axisCount = 0;
+  };
+
+  struct alignas(32) CellBatch {
+    float x[Width] = {};
+    float y[Width] = {};
+    float z[Width] = {};
+    glm::ivec3 cells[Width];
+    unsigned int size = 0;
+  };
+
+  inline void addAxis(Triangle &triangle, glm::vec3 axis, const glm::vec3 &v0, const glm::vec3 &v1, const glm::vec3 &v2, const glm::vec3 &halfSize) {
+    // Parallel edges give a zero axis, it can't separate anything
+    if (axis.x == 0.0f && axis.y == 0.0f && axis.z == 0.0f) {
+      return;
+    }
+
+    float p0 = glm::dot(axis, v0);
+    float p1 = glm::dot(axis, v1);
+    float p2 = glm::dot(axis, v2);
+
+    unsigned int index = triangle.axisCount++;
+    triangle.axisX[index] = axis.x;
+    triangle.axisY[index] = axis.y;
+    triangle.axisZ[index] = axis.z;
+    triangle.minProjection[index] = std::fmin(p0, std::fmin(p1, p2));
+    triangle.maxProjection[index] = std::fmax(p0, std::fmax(p1, p2));
+    triangle.radius[index] = glm::dot(halfSize, glm::abs(axis));
+  };
+
+  /**
+   * halfSize should already include the tolerance, touching boxes count as overlapping
+   */
+  inline void prepare(Triangle &triangle, glm::vec3 v0, glm::vec3 v1, glm::vec3 v2, glm::vec3 halfSize) {
+    glm::vec3 edges[3] = { v1 - v0, v2 - v1, v0 - v2 };
+    glm::vec3 boxAxes[3] = { glm::vec3(1.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f), glm::vec3(0.0f, 0.0f, 1.0f) };
+
+    triangle.axisCount = 0;
+
+    for (unsigned int i = 0; i < 3; i++) {
+      addAxis(triangle, boxAxes[i], v0, v1, v2, halfSize);
+    }
+
+    addAxis(triangle, glm::cross(edges[0], edges[1]), v0, v1, v2, halfSize);
+
+    for (unsigned int i = 0; i < 3; i++) {
+      for (unsigned int k = 0; k < 3; k++) {
+        addAxis(triangle, glm::cross(edges[i], boxAxes[k]), v0, v1, v2, halfSize);
+      }
+    }
+  };
+
+  /**
+   * Returns a bit per box of the batch, set when the box overlaps the triangle
+   */
+  inline unsigned int test(const Triangle &triangle, const CellBatch &batch) {
+    unsigned int used = (1u << batch.size) - 1u;
+
+#if defined(TRIANGLEBOX_SCALAR)
+    unsigned int result = 0;
+
+    for (unsigned int c = 0; c < batch.size; c++) {
+      bool separated = false;
+
+      for (unsigned int i = 0; i < triangle.axisCount && !separated; i++) {
+        float center = triangle.axisX[i] * batch.x[c] + triangle.axisY[i] * batch.y[c] + triangle.axisZ[i] * batch.z[c];
+        separated = (triangle.minProjection[i] > center + triangle.radius[i]) || (triangle.maxProjection[i] < center - triangle.radius[i]);
+      }
+
+      if (!separated) {
+        result |= (1u << c);
+      }
+    }
+
+    return result;
+#elif defined(__AVX__)
+    __m256 x = _mm256_load_ps(batch.x);
+    __m256 y = _mm256_load_ps(batch.y);
+    __m256 z = _mm256_load_ps(batch.z);
+    __m256 separated = _mm256_setzero_ps();
+
+    for (unsigned int i = 0; i < triangle.axisCount; i++) {
+      __m256 center = _mm256_add_ps(
+        _mm256_add_ps(_mm256_mul_ps(_mm256_set1_ps(triangle.axisX[i]), x), _mm256_mul_ps(_mm256_set1_ps(triangle.axisY[i]), y)),
+        _mm256_mul_ps(_mm256_set1_ps(triangle.axisZ[i]), z)
+      );
+      __m256 radius = _mm256_set1_ps(triangle.radius[i]);
+
+      separated = _mm256_or_ps(separated, _mm256_cmp_ps(_mm256_set1_ps(triangle.minProjection[i]), _mm256_add_ps(center, radius), _CMP_GT_OQ));
+      separated = _mm256_or_ps(separated, _mm256_cmp_ps(_mm256_set1_ps(triangle.maxProjection[i]), _mm256_sub_ps(center, radius), _CMP_LT_OQ));
+
+      // Every box is already out, the other axes can't change it
+      if ((unsigned int) _mm256_movemask_ps(separated) == 0xFFu) {
+        break;
+      }
+    }
+
+    return ~((unsigned int) _mm256_movemask_ps(separated)) & used;
+#else
+    __m128 x = _mm_load_ps(batch.x);
+    __m128 y = _mm_load_ps(batch.y);
+    __m128 z = _mm_load_ps(batch.z);
+    __m128 separated = _mm_setzero_ps();
+
+    for (unsigned int i = 0; i < triangle.axisCount; i++) {
+      __m128 center = _mm_add_ps(
+        _mm_add_ps(_mm_mul_ps(_mm_set1_ps(triangle.axisX[i]), x), _mm_mul_ps(_mm_set1_ps(triangle.axisY[i]), y)),
+        _mm_mul_ps(_mm_set1_ps(triangle.axisZ[i]), z)
+      );
+      __m128 radius = _mm_set1_ps(triangle.radius[i]);
+
+      separated = _mm_or_ps(separated, _mm_cmpgt_ps(_mm_set1_ps(triangle.minProjection[i]), _mm_add_ps(center, radius)));
+      separated = _mm_or_ps(separated, _mm_cmplt_ps(_mm_set1_ps(triangle.maxProjection[i]), _mm_sub_ps(center, radius)));
+
+      // Every box is already out, the other axes can't change it
+      if ((unsigned int) _mm_movemask_ps(separated) == 0xFu) {
+        break;
+      }
+    }
+
+    return ~((unsigned int) _mm_movemask_ps(separated)) & used;
+#endif
+  };
+};
+
+#endif // __TRIANGLEBOXSIMD_H__
@@ -1,6 +1,8 @@
 #include "./Loader.h"
 
-
+#include <set>
+#include <mutex>
+#include <unordered_map>
 
 
 float math::deltaX(glm::vec3 &a, glm::vec3 &b, float x) {
@@ -39,6 +41,7 @@ MaterialObject Material::clone(bool deep) {
   MaterialObject next = std::make_shared<Material>();
 
   next->name = this->name;
+  next->id = this->id;
   // next->baseName = this->baseName;
   next->color = this->color;
 
@@ -49,6 +52,25 @@ MaterialObject Material::clone(bool deep) {
   return next;
 };
 
+void Material::setName(const std::string &name) {
+  this->name = name;
+  this->id = Material::intern(name);
+};
+
+unsigned int Material::intern(const std::string &name) {
+  static std::mutex mutex;
+  static std::unordered_map<std::string, unsigned int> ids;
+
+  if (name == "") {
+    return 0;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex);
+  std::pair<std::unordered_map<std::string, unsigned int>::iterator, bool> inserted = ids.insert(std::make_pair(name, (unsigned int) ids.size() + 1));
+
+  return inserted.first->second;
+};
+
 void Group::traverse(TraverseMeshCallback fn) {
   for (GroupObject &group : this->children) // access by reference to avoid copying
   {  
@@ -61,6 +83,19 @@ void Group::traverse(TraverseMeshCallback fn) {
   }
 };
 
+size_t Group::byteSize() {
+  size_t size = 0;
+
+  this->traverse([&](MeshObject mesh){
+    size += mesh->position.size() * sizeof(glm::vec3);
+    size += mesh->normal.size() * sizeof(glm::vec3);
+    size += mesh->uv.size() * sizeof(glm::vec2);
+    size += mesh->faces.size() * sizeof(Face);
+  });
+
+  return size;
+};
+
 void Group::traverseGroup(TraverseGroupCallback fn) {
   for (GroupObject &group : this->children) // access by reference to avoid copying
   {
@@ -499,6 +534,20 @@ Loader::Loader() {
   this->object->name = "root";
 };
 
+void Loader::setCrop(BBoxf box) {
+  this->crop = box;
+  this->hasCrop = true;
+};
+
+bool Loader::insideCrop(glm::vec3 &a, glm::vec3 &b, glm::vec3 &c) {
+  glm::vec3 centroid = (a + b + c) / 3.0f;
+
+  // Half-open so that neighbouring boxes never take the same face
+  return centroid.x >= this->crop.min.x && centroid.x < this->crop.max.x &&
+    centroid.y >= this->crop.min.y && centroid.y < this->crop.max.y &&
+    centroid.z >= this->crop.min.z && centroid.z < this->crop.max.z;
+};
+
 BBoxf BBoxf::clone() {
   BBoxf cloned;
 
@@ -664,195 +713,110 @@ void BBoxf::setSize(glm::vec3 size) {
 void Image::free() {
   if (this->data != NULL) {
     stbi_image_free(this->data);
+    // Meshes sharing the material free it again
+    this->data = NULL;
   }
 };
 
 void Loader::free() {
   std::cout << "Cleaning up the memory..." << std::endl; 
-  this->object->traverse([&](MeshObject mesh){
-    mesh->material->diffuseMapImage.free();
-  });
 
-  std::cout << "Memory has been cleaned" << std::endl;
-};
+  // Materials sharing a texture share the image data
+  std::set<unsigned char*> freed;
+  for (MaterialObject &material : this->materials) {
+    unsigned char* data = material->diffuseMapImage.data;
 
-
-Vertex::Vertex() {};
-Vertex::Vertex(glm::vec3 vector) {
-  this->position = vector;
-};
-
-bool Vertex::hasNeighbor(VertexPtr vertex) {
-  for (VertexPtr &target : this->neighbors) // access by reference to avoid copying
-  {
-    if (target->id == vertex->id) {
-      return true;
+    if (data != NULL && freed.count(data) == 0) {
+      freed.insert(data);
+      material->diffuseMapImage.free();
     }
-  }
-
-  return false;
-};
 
-void Vertex::addUniqueNeighbor(VertexPtr vertex) {
-  if (!this->hasNeighbor(vertex)) {
-    this->neighbors.push_back(vertex);
+    material->diffuseMapImage.data = NULL;
   }
-};
-
-void Vertex::removeIfNonNeighbor(VertexPtr vertex) {
-  if (this->hasNeighbor(vertex)) {
-    bool isPartOfFace = false;
-
-    for (TrianglePtr &target : this->faces) // access by reference to avoid copying
-    {
-      if (target->hasVertex(vertex)) {
-        isPartOfFace = true;
-        break;
-      }
-    }
-
-    if (!isPartOfFace) {
-      this->neighbors.erase(
-        std::remove_if(
-          this->neighbors.begin(), 
-          this->neighbors.end(),
-          [&](VertexPtr v){ return v->id == vertex->id; }
-        ),
-        this->neighbors.end()
-      );
-    }
-  }
-};
-
-void Vertex::removeTriangle(TrianglePtr triangle) {
-  this->faces.erase(
-    std::remove_if(
-      this->faces.begin(), 
-      this->faces.end(),
-      [&](TrianglePtr t){ return t->id == triangle->id; }
-    ),
-    this->faces.end()
-  );
-  // std::remove(this->faces.begin(), this->faces.end(), triangle),
-};
-
-Triangle::Triangle(VertexPtr v1, VertexPtr v2, VertexPtr v3, Face f) {
-  this->v1 = v1;
-  this->v2 = v2;
-  this->v3 = v3;
-
-  this->face = f;
-
-  this->computeNormal();
+  this->materials.clear();
 
-  this->v1->addUniqueNeighbor(this->v2);
-  this->v1->addUniqueNeighbor(this->v3);
-
-  this->v2->addUniqueNeighbor(this->v1);
-  this->v2->addUniqueNeighbor(this->v3);
-
-  this->v3->addUniqueNeighbor(this->v1);
-  this->v3->addUniqueNeighbor(this->v2);
-};
-
-void Triangle::init() {
-  this->v1->faces.push_back(shared_from_this());
-  this->v2->faces.push_back(shared_from_this());
-  this->v3->faces.push_back(shared_from_this());
+  std::cout << "Memory has been cleaned" << std::endl;
 };
 
-void Triangle::computeNormal() {
-  glm::vec3 vA = this->v1->position;
-  glm::vec3 vB = this->v2->position;
-  glm::vec3 vC = this->v3->position;
-
-  glm::vec3 _ab;
-  glm::vec3 _cb;
 
-  _cb = vC - vB;
-  _ab = vA - vB;
-  // _cb.sub(vC, vB);
-  // _ab.sub(vA, vB);
-
-  // _cb.cross(_ab);
-  _cb = glm::cross(_cb, _ab);
-
-  // if (_cb.length() != 0.0f) {
-  //   _cb.normalize();
-  // }
+/**
+ * Closest point of the triangle a, b, c to the point p, on the face, an edge or a corner.
+ * uv are the weights of c and b, the same as clothestTrianglePointOld gives: data = a + uv.x * (c - a) + uv.y * (b - a).
+ * Based on Ericson, Real-Time Collision Detection, 5.1.5
+ */
+Vec3Result math::clothestTrianglePoint(glm::vec3 p, glm::vec3 a, glm::vec3 b, glm::vec3 c) {
+  Vec3Result result;
 
-  // this->normal.set(_cb);
+  glm::vec3 ab = b - a;
+  glm::vec3 ac = c - a;
+  glm::vec3 ap = p - a;
 
-  if (glm::length(_cb) != 0.0f) {
-    glm::normalize(_cb);
+  // Corner regions
+  float d1 = glm::dot(ab, ap);
+  float d2 = glm::dot(ac, ap);
+  if (d1 <= 0.0f && d2 <= 0.0f) {
+    result.data = a;
+    result.uv = glm::vec2(0.0f, 0.0f);
+    return result;
   }
 
-  this->normal = _cb;
-};
-
-bool Triangle::hasVertex(VertexPtr vertex) {
-  return this->v1->id == vertex->id || this->v2->id == vertex->id || this->v3->id == vertex->id;
-};
-
-void Triangle::replaceVertex(VertexPtr oldVertex, VertexPtr newVertex) {
-  // newVertex->geometricError += oldVertex->position.distanceTo(newVertex->position);
-  newVertex->geometricError = glm::distance(oldVertex->position, newVertex->position);
-
-  if (oldVertex->id == this->v1->id) {
-    this->v1 = newVertex;
-  } else if (oldVertex->id == this->v2->id) {
-    this->v2 = newVertex;
-  } else if (oldVertex->id == this->v3->id) {
-    this->v3 = newVertex;
+  glm::vec3 bp = p - b;
+  float d3 = glm::dot(ab, bp);
+  float d4 = glm::dot(ac, bp);
+  if (d3 >= 0.0f && d4 <= d3) {
+    result.data = b;
+    result.uv = glm::vec2(0.0f, 1.0f);
+    return result;
   }
 
-  oldVertex->removeTriangle(shared_from_this());
-  newVertex->faces.push_back(shared_from_this());
-
-  oldVertex->removeIfNonNeighbor(this->v1);
-  this->v1->removeIfNonNeighbor(oldVertex);
-
-  oldVertex->removeIfNonNeighbor(this->v2);
-  this->v2->removeIfNonNeighbor(oldVertex);
-
-  oldVertex->removeIfNonNeighbor(this->v3);
-  this->v3->removeIfNonNeighbor(oldVertex);
-
-  this->v1->addUniqueNeighbor(this->v2);
-  this->v1->addUniqueNeighbor(this->v3);
-
-  this->v2->addUniqueNeighbor(this->v1);
-  this->v2->addUniqueNeighbor(this->v3);
-
-  this->v3->addUniqueNeighbor(this->v1);
-  this->v3->addUniqueNeighbor(this->v2);
-
-  this->computeNormal();
-};
-
-Vec3Result math::clothestTrianglePoint(glm::vec3 p, glm::vec3 a, glm::vec3 b, glm::vec3 c) {
-  Vec3Result result;
-  result.data = glm::vec3(0.0f);
+  glm::vec3 cp = p - c;
+  float d5 = glm::dot(ab, cp);
+  float d6 = glm::dot(ac, cp);
+  if (d6 >= 0.0f && d5 <= d6) {
+    result.data = c;
+    result.uv = glm::vec2(1.0f, 0.0f);
+    return result;
+  }
 
-  glm::vec3 diff1 = p - a;
-  glm::vec3 diff2 = p - b;
-  glm::vec3 diff3 = p - c;
+  // Edge regions
+  float vc = d1 * d4 - d3 * d2;
+  if (vc <= 0.0f && d1 >= 0.0f && d3 <= 0.0f) {
+    float v = d1 / (d1 - d3);
+    result.data = a + v * ab;
+    result.uv = glm::vec2(0.0f, v);
+    return result;
+  }
 
-  float distSq1 = glm::length(diff1);
-  float distSq2 = glm::length(diff2);
-  float distSq3 = glm::length(diff3);
+  float vb = d5 * d2 - d1 * d6;
+  if (vb <= 0.0f && d2 >= 0.0f && d6 <= 0.0f) {
+    float w = d2 / (d2 - d6);
+    result.data = a + w * ac;
+    result.uv = glm::vec2(w, 0.0f);
+    return result;
+  }
 
-  float min = std::min(distSq1, distSq2);
-  min = std::min(min, distSq3);
+  float va = d3 * d6 - d5 * d4;
+  if (va <= 0.0f && (d4 - d3) >= 0.0f && (d5 - d6) >= 0.0f) {
+    float w = (d4 - d3) / ((d4 - d3) + (d5 - d6));
+    result.data = b + w * (c - b);
+    result.uv = glm::vec2(w, 1.0f - w);
+    return result;
+  }
 
-  if (min == distSq1) {
+  // Inside the face, a degenerate triangle has no face region
+  float area = va + vb + vc;
+  if (area <= 0.0f) {
     result.data = a;
-  } else if (min == distSq2) {
-    result.data = b;
-  } else {
-    result.data = c;
+    result.uv = glm::vec2(0.0f, 0.0f);
+    return result;
   }
 
+  float denom = 1.0f / area;
+  float v = vb * denom;
+  float w = vc * denom;
+
+  result.data = a + ab * v + ac * w;
+  result.uv = glm::vec2(w, v);
   return result;
 };
 
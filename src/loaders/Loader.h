@@ -23,12 +23,8 @@
 
 class Mesh;
 class Group;
-class Vertex;
-class Triangle;
 class Material;
 
-typedef std::shared_ptr<Vertex> VertexPtr;
-typedef std::shared_ptr<Triangle> TrianglePtr;
 typedef std::shared_ptr<Mesh> MeshObject;
 typedef std::shared_ptr<Group> GroupObject;
 typedef std::shared_ptr<Material> MaterialObject;
@@ -66,64 +62,6 @@ struct Face {
 };
 
 
-class Vertex {
-  public:
-    Vertex();
-    Vertex(glm::vec3 vector);
-
-    glm::vec3 position;
-    glm::vec3 normal;
-    glm::vec2 uv;
-
-    std::vector<TrianglePtr> faces;
-    std::vector<VertexPtr> neighbors;
-
-    float collapseCost = 0.0f;
-    VertexPtr collapseNeighbor = NULL;
-
-    float geometricError = 0.0f;
-
-    float minCost = 0.0f;
-    float totalCost = 0.0f;
-    unsigned int costCount = 0;
-
-    unsigned int id = 0;
-    unsigned int positionId = 0;
-
-    void addUniqueNeighbor(VertexPtr vertex);
-    void removeIfNonNeighbor(VertexPtr vertex);
-    bool hasNeighbor(VertexPtr vertex);
-    void removeTriangle(TrianglePtr triangle);
-
-    // bool operator < (const Vertex& str) const
-    // {
-    //   return (this->collapseCost < str.collapseCost);
-    // }
-};
-
-class Triangle : public std::enable_shared_from_this<Triangle> {
-  public:
-    Triangle(VertexPtr v1, VertexPtr v2, VertexPtr v3, Face f);
-    void init();
-
-    unsigned int id = 0;
-
-    VertexPtr v1;
-    VertexPtr v2;
-    VertexPtr v3;
-
-    std::vector<glm::vec2> faceVertexUvs;
-
-    Face face;
-    glm::vec3 normal;
-
-    void computeNormal();
-    bool hasVertex(VertexPtr vertex);
-    void replaceVertex(VertexPtr oldVertex, VertexPtr newVertex);
-};
-
-
-
 struct BBoxf {
   glm::vec3 min, max;
   void extend(glm::vec3 position);
@@ -155,6 +93,8 @@ struct Image {
 class Material {
   public:
     std::string name = "";
+    // Dense id interned from the name, equal names share it, 0 - no name
+    unsigned int id = 0;
     std::string baseName = "";
 
     std::string diffuseMap = "";
@@ -164,6 +104,9 @@ class Material {
     glm::vec3 color;
 
     MaterialObject clone(bool deep);
+    void setName(const std::string &name);
+
+    static unsigned int intern(const std::string &name);
 };
 
 typedef std::map<std::string, MaterialObject> MaterialMap;
@@ -184,6 +127,7 @@ class Group {
     void computeBoundingBox();
     void computeUVBox();
     void computeGeometricError();
+    size_t byteSize();
 
     void free(bool deep = true);
 
@@ -222,8 +166,17 @@ class Mesh : public Group {
 class Loader {
   public:
     GroupObject object = GroupObject(new Group());
+    // Kept apart from the object so that the textures can be freed after the object was handed over
+    std::vector<MaterialObject> materials;
     Loader();
 
+    // Faces with the centroid outside of the crop box are skipped, used by the distributed workers
+    bool hasCrop = false;
+    BBoxf crop;
+
+    void setCrop(BBoxf box);
+    bool insideCrop(glm::vec3 &a, glm::vec3 &b, glm::vec3 &c);
+
     void free();
 
     virtual void parse(const char* path) {};
@@ -29,7 +29,9 @@ MaterialMap ObjLoader::loadMaterials(const char* path) {
 
   std::map<std::string, unsigned char*> imageList;
 
-  std::map<std::string, Image> imageMap;
+  // The first material with a texture path loads it, the others get a copy after decoding
+  std::map<std::string, MaterialObject> imageMap;
+  std::vector<std::pair<MaterialObject, std::string>> imageUsers;
 
   std::cout << "Materials file is opened, processing...: " << std::endl;
 
@@ -51,7 +53,7 @@ MaterialMap ObjLoader::loadMaterials(const char* path) {
       ss >> lastMaterialName;
 
       MaterialObject currentMaterial = std::make_shared<Material>();
-      currentMaterial->name = lastMaterialName;
+      currentMaterial->setName(lastMaterialName);
       currentMaterial->baseName = lastMaterialName;
 
       materialMap[lastMaterialName] = currentMaterial;
@@ -65,10 +67,8 @@ MaterialMap ObjLoader::loadMaterials(const char* path) {
           ).c_str();
 
 
-        Image &diffuseMapImage = materialMap[lastMaterialName]->diffuseMapImage;
-
         if ( imageMap.find(imagePath) == imageMap.end() ) {
-          imageMap[imagePath] = diffuseMapImage;
+          imageMap[imagePath] = materialMap[lastMaterialName];
           // std::cout << "Found an image:" << materialMap[lastMaterialName]->diffuseMap.c_str() << std::endl;
 
           std::cout << "Loading image: " << imagePath.c_str() << std::endl;
@@ -81,6 +81,7 @@ MaterialMap ObjLoader::loadMaterials(const char* path) {
           task->texturePath = imagePath.c_str();
 
           this->pool.create(
+            0,
             bind(&ObjLoader::loadTexture, this, std::placeholders::_1),
             task
           );
@@ -112,10 +113,11 @@ MaterialMap ObjLoader::loadMaterials(const char* path) {
           // }
 
           // std::cout << "Image width: " << diffuseMapImage.width << ", height: " << diffuseMapImage.height << ", channels: " << diffuseMapImage.channels << std::endl;
+        } else {
+          imageUsers.push_back(std::make_pair(materialMap[lastMaterialName], imagePath));
         }
         
         // diffuseMapImage.data = imageList[imagePath];
-        materialMap[lastMaterialName]->diffuseMapImage = imageMap[imagePath];
 
         // if(diffuseMapImage.data == NULL) {
         //   std::cerr << "Image loading error" << std::endl;
@@ -129,6 +131,10 @@ MaterialMap ObjLoader::loadMaterials(const char* path) {
 
   this->pool.finish();
 
+  for (std::pair<MaterialObject, std::string> &user : imageUsers) {
+    user.first->diffuseMapImage = imageMap[user.second]->diffuseMapImage;
+  }
+
   input.close();
   imageList.clear();
 
@@ -243,6 +249,14 @@ void ObjLoader::parse(const char* path) {
   }
 
   std::cout << "Model file is opened, processing..." << std::endl;
+
+  Progress &progress = Progress::GetInstance();
+  input.seekg(0, std::ios::end);
+  progress.setInputSize(input.tellg());
+  input.seekg(0, std::ios::beg);
+
+  uint64_t bytesRead = 0;
+  unsigned int linesRead = 0;
   
   std::string line;
   std::string token;
@@ -265,6 +279,17 @@ void ObjLoader::parse(const char* path) {
 
   while (getline(input, line))
   {
+    bytesRead += line.size() + 1;
+    if (++linesRead == 65536) {
+      progress.add(ProgressStage::Import, 0, bytesRead);
+      bytesRead = 0;
+      linesRead = 0;
+
+      if (progress.isCancelled()) {
+        break;
+      }
+    }
+
     ss.clear();
     ss.str(line);
 
@@ -276,6 +301,10 @@ void ObjLoader::parse(const char* path) {
 
       if (materialFile != "") {
         materialMap = this->loadMaterials(utils::concatPath(utils::getDirectory(path), materialFile).c_str());
+
+        for (auto const& [name, material] : materialMap) {
+          this->materials.push_back(material);
+        }
       }
     } else if (token == "old one o") { // Process objects
       if (currentMesh != nullptr) {
@@ -374,6 +403,10 @@ void ObjLoader::parse(const char* path) {
       }
       
       for (int t = 1; t < points - 1; t += 1) {
+        if (this->hasCrop && !this->insideCrop(position[positionIndices[0]], position[positionIndices[t]], position[positionIndices[t + 1]])) {
+          continue;
+        }
+
         Face face;
 
         face.positionIndices[0] = positionIndices[0];
@@ -408,9 +441,12 @@ void ObjLoader::parse(const char* path) {
   //std::cout << "Finished before by end of func" << std::endl;
   // currentMesh->finish();
   std::cout << "Model has been loaded" << std::endl;
+  progress.add(ProgressStage::Import, 1, bytesRead);
 
   //currentGroup->meshes.push_back(currentMesh);
-  this->finishMesh(currentGroup, currentMesh, position, normal, uv);
+  if (currentMesh->faces.size() > 0) {
+    this->finishMesh(currentGroup, currentMesh, position, normal, uv);
+  }
   this->object->computeBoundingBox();
 
   materialMap.clear();
@@ -12,6 +12,7 @@
 
 #include "Loader.h"
 #include "./../split/Pool.h"
+#include "./../helpers/Progress.h"
 
 class TextureLoadTask {
   public:
@@ -26,7 +27,7 @@ typedef PoolFnTemplate<std::shared_ptr<TextureLoadTask>> TextureLoadPoolFn;
 
 class ObjLoader : public Loader {
   public:
-    SplitPool<TextureLoadPoolFn> pool;
+    SplitPool<TextureLoadPoolFn> pool{TaskClass::Decode};
     // std::unordered_map<std::string, bool> processedImages;
 
     void parse(const char* path);
@@ -8,8 +8,11 @@
 #include "./exporters/ObjExporter.h"
 #include "./exporters/GLTFExporter.h"
 #include "./exporters/B3DMExporter.h"
+#include "./exporters/TileWriter.h"
 
 #include "App.h"
+#include "./helpers/Progress.h"
+#include "./helpers/Scheduler.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #define STB_IMAGE_WRITE_IMPLEMENTATION
@@ -25,6 +28,12 @@ int main(int argc, char** argv) {
   Exporter::addCreator(GLTFExporter::Type, GLTFExporter::create);
   Exporter::addCreator(B3DMExporter::Type, B3DMExporter::create);
 
+  TileWriter::addCreator(SyncTileWriter::Type, SyncTileWriter::create);
+  TileWriter::addCreator(ThreadTileWriter::Type, ThreadTileWriter::create);
+#ifdef TILEWRITER_URING
+  TileWriter::addCreator(UringTileWriter::Type, UringTileWriter::create);
+#endif
+
   SplitInterface::addCreator(RegularSplitter::Type, RegularSplitter::create);
   SplitInterface::addCreator(VoxelsSplitter::Type, VoxelsSplitter::create);
 
@@ -46,7 +55,15 @@ int main(int argc, char** argv) {
     return 0;
   }
 
-  App::run();
-  
-  return 0;
+  if (!Scheduler::GetInstance().configure(opts.threads, (uint64_t) opts.memoryLimit * 1024 * 1024, opts.classThreads, opts.classPriority, opts.schedulerConfig)) {
+    return 0;
+  }
+
+  bool result = App::run();
+
+  if (Progress::GetInstance().isCancelled()) {
+    return 130;
+  }
+
+  return result ? 0 : 1;
 }
\ No newline at end of file
@@ -0,0 +1,118 @@
+#include "CornerTable.h"
+
+#include <algorithm>
+
+void CornerTable::init(unsigned int vertexCount, const std::vector<glm::uvec3> &faces) {
+  this->corners.resize(faces.size() * 3);
+  this->nextCorners.resize(faces.size() * 3);
+  this->firstCorners.assign(vertexCount, CORNER_NONE);
+  this->removed.assign(faces.size(), 0);
+  this->liveCount = faces.size();
+  this->visited.assign(vertexCount, 0);
+  this->visitStamp = 0;
+
+  for (unsigned int f = 0; f < faces.size(); f++) {
+    for (unsigned int i = 0; i < 3; i++) {
+      this->corners[f * 3 + i] = faces[f][i];
+    }
+  }
+
+  // Chained backwards, so a vertex lists its corners in face order
+  for (unsigned int c = this->corners.size(); c-- > 0;) {
+    unsigned int vertex = this->corners[c];
+
+    this->nextCorners[c] = this->firstCorners[vertex];
+    this->firstCorners[vertex] = c;
+  }
+};
+
+void CornerTable::clear() {
+  std::vector<unsigned int>().swap(this->corners);
+  std::vector<unsigned int>().swap(this->nextCorners);
+  std::vector<unsigned int>().swap(this->firstCorners);
+  std::vector<unsigned char>().swap(this->removed);
+  std::vector<unsigned int>().swap(this->visited);
+  this->liveCount = 0;
+  this->visitStamp = 0;
+};
+
+bool CornerTable::hasVertex(unsigned int face, unsigned int vertex) const {
+  return this->corners[face * 3] == vertex || this->corners[face * 3 + 1] == vertex || this->corners[face * 3 + 2] == vertex;
+};
+
+void CornerTable::neighbors(unsigned int vertex, std::vector<unsigned int> &result) const {
+  result.clear();
+
+  // A new stamp marks the vertices listed by this call, the marks are reset only when it wraps
+  if (++this->visitStamp == 0) {
+    std::fill(this->visited.begin(), this->visited.end(), 0);
+    this->visitStamp = 1;
+  }
+
+  this->visited[vertex] = this->visitStamp;
+
+  for (unsigned int c = this->firstCorners[vertex]; c != CORNER_NONE; c = this->nextCorners[c]) {
+    unsigned int face = CornerTable::face(c);
+
+    // The other corners in the order of the face
+    for (unsigned int i = 0; i < 3; i++) {
+      unsigned int other = this->corners[face * 3 + i];
+
+      if (this->visited[other] != this->visitStamp) {
+        this->visited[other] = this->visitStamp;
+        result.push_back(other);
+      }
+    }
+  }
+};
+
+void CornerTable::unlink(unsigned int corner) {
+  unsigned int* link = &this->firstCorners[this->corners[corner]];
+
+  while (*link != CORNER_NONE) {
+    if (*link == corner) {
+      *link = this->nextCorners[corner];
+      break;
+    }
+
+    link = &this->nextCorners[*link];
+  }
+
+  this->nextCorners[corner] = CORNER_NONE;
+};
+
+void CornerTable::removeFace(unsigned int face) {
+  if (this->removed[face]) {
+    return;
+  }
+
+  for (unsigned int i = 0; i < 3; i++) {
+    this->unlink(face * 3 + i);
+  }
+
+  this->removed[face] = 1;
+  this->liveCount--;
+};
+
+void CornerTable::replaceVertex(unsigned int from, unsigned int to) {
+  unsigned int first = this->firstCorners[from];
+  if (first == CORNER_NONE || from == to) {
+    return;
+  }
+
+  unsigned int last = first;
+  for (unsigned int c = first; c != CORNER_NONE; c = this->nextCorners[c]) {
+    this->corners[c] = to;
+    last = c;
+  }
+
+  // The chain of from goes after the corners of to
+  unsigned int* link = &this->firstCorners[to];
+  while (*link != CORNER_NONE) {
+    link = &this->nextCorners[*link];
+  }
+
+  *link = first;
+  this->nextCorners[last] = CORNER_NONE;
+  this->firstCorners[from] = CORNER_NONE;
+};
@@ -0,0 +1,88 @@
+#ifndef __CORNERTABLE_H__
+#define __CORNERTABLE_H__
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#define CORNER_NONE 0xFFFFFFFFu
+
+/**
+ * Index-based triangle connectivity for the simplifiers, everything lives in flat arrays.
+ * Corner c is the corner (c % 3) of the face c / 3, corners[c] is its vertex.
+ * The corners of a vertex are chained through nextCorner, so the faces and the neighbors of a vertex
+ * are visited, and a collapse is applied, in O(valence) without searching the mesh.
+ * Unlinking a corner walks the chain of its vertex, so removing or moving a face is O(valence) too.
+ */
+class CornerTable {
+  public:
+    std::vector<unsigned int> corners;
+
+    void init(unsigned int vertexCount, const std::vector<glm::uvec3> &faces);
+    void clear();
+
+    unsigned int vertexCount() const {
+      return this->firstCorners.size();
+    };
+
+    unsigned int faceCount() const {
+      return this->corners.size() / 3;
+    };
+
+    // Faces that are not removed
+    unsigned int liveFaces() const {
+      return this->liveCount;
+    };
+
+    static unsigned int face(unsigned int corner) {
+      return corner / 3;
+    };
+
+    static unsigned int next(unsigned int corner) {
+      return (corner % 3 == 2) ? corner - 2 : corner + 1;
+    };
+
+    static unsigned int prev(unsigned int corner) {
+      return (corner % 3 == 0) ? corner + 2 : corner - 1;
+    };
+
+    unsigned int vertex(unsigned int face, unsigned int index) const {
+      return this->corners[face * 3 + index];
+    };
+
+    // First corner of the vertex and the one after the given corner, CORNER_NONE at the end
+    unsigned int firstCorner(unsigned int vertex) const {
+      return this->firstCorners[vertex];
+    };
+
+    unsigned int nextCorner(unsigned int corner) const {
+      return this->nextCorners[corner];
+    };
+
+    bool isRemoved(unsigned int face) const {
+      return this->removed[face] != 0;
+    };
+
+    bool hasVertex(unsigned int face, unsigned int vertex) const;
+    // Vertices sharing a face with the vertex, in the order of its corners.
+    // Not thread safe, the duplicates are skipped with marks kept in the table
+    void neighbors(unsigned int vertex, std::vector<unsigned int> &result) const;
+
+    // Unlinks the corners of the face from their vertices
+    void removeFace(unsigned int face);
+    // The corners of from go to to, from is left without faces
+    void replaceVertex(unsigned int from, unsigned int to);
+
+  private:
+    std::vector<unsigned int> firstCorners;
+    std::vector<unsigned int> nextCorners;
+    std::vector<unsigned char> removed;
+    unsigned int liveCount = 0;
+
+    // Marks of the vertices the last neighbors() call listed
+    mutable std::vector<unsigned int> visited;
+    mutable unsigned int visitStamp = 0;
+
+    void unlink(unsigned int corner);
+};
+
+#endif // __CORNERTABLE_H__
@@ -0,0 +1,65 @@
+#ifndef __SIMPLIFYLOCKS_H__
+#define __SIMPLIFYLOCKS_H__
+
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <unordered_set>
+#include <glm/glm.hpp>
+
+struct LockPlane {
+  // 0 - x, 1 - y, 2 - z
+  unsigned int axis;
+  float value;
+};
+
+struct LockPointHash {
+  size_t operator()(const glm::vec3 &position) const {
+    // -0 and +0 compare equal, adding zero turns both into +0 so they hash the same too
+    glm::vec3 normalized = position + glm::vec3(0.0f);
+    uint32_t bits[3];
+    std::memcpy(bits, &normalized, sizeof(bits));
+
+    return (size_t) (bits[0] * 73856093u) ^ (size_t) (bits[1] * 19349663u) ^ (size_t) (bits[2] * 83492791u);
+  };
+};
+
+/**
+ * Vertices the simplifiers keep in place because they are shared with the neighboring chunks,
+ * so the simplified neighbors still meet without cracks.
+ * planes - the axis-aligned planes a mesh was clipped by, points - positions shared with a chunk cut without clipping.
+ */
+class SimplifyLocks {
+  public:
+    std::vector<LockPlane> planes;
+    std::unordered_set<glm::vec3, LockPointHash> points;
+
+    void addPlane(unsigned int axis, float value) {
+      this->planes.push_back({ axis, value });
+    };
+
+    void addPoint(const glm::vec3 &position) {
+      this->points.insert(position);
+    };
+
+    bool empty() const {
+      return this->planes.empty() && this->points.empty();
+    };
+
+    // The clipped vertices are interpolated, so they are only within a few ulps of the plane
+    bool contains(const glm::vec3 &position) const {
+      for (const LockPlane &plane : this->planes) {
+        float tolerance = 1e-5f * std::max(1.0f, std::fabs(plane.value));
+
+        if (std::fabs(position[plane.axis] - plane.value) <= tolerance) {
+          return true;
+        }
+      }
+
+      return this->points.count(position) != 0;
+    };
+};
+
+#endif // __SIMPLIFYLOCKS_H__
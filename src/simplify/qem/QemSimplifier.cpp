@@ -0,0 +1,382 @@
+#include "QemSimplifier.h"
+
+#include <cfloat>
+#include <unordered_map>
+
+GroupObject QemSimplifier::simplify(GroupObject &group) {
+  GroupObject result = GroupObject(new Group());
+  result->name = group->name;
+
+  unsigned int totalFaces = 0;
+  group->traverse([&](MeshObject mesh){
+    totalFaces += mesh->faces.size();
+  });
+
+  unsigned int groupTarget = this->targetFaces;
+
+  group->traverse([&](MeshObject mesh){
+    if (groupTarget > 0 && totalFaces > 0) {
+      this->targetFaces = std::max(1u, (unsigned int) ((uint64_t) groupTarget * mesh->faces.size() / totalFaces));
+    }
+
+    result->meshes.push_back(this->simplify(mesh));
+  });
+
+  this->targetFaces = groupTarget;
+
+  return result;
+};
+
+MeshObject QemSimplifier::simplify(MeshObject &mesh) {
+  this->load(mesh);
+  this->computeQuadrics();
+  this->lockBorders();
+
+  this->queue.reset(this->positions.size());
+  for (unsigned int i = 0; i < this->positions.size(); i++) {
+    this->update(i);
+  }
+
+  this->maxError = 0.0f;
+
+  while (!this->queue.empty() && (this->targetFaces > 0 || this->targetError > 0.0f)) {
+    if (this->targetFaces > 0 && this->table.liveFaces() <= this->targetFaces) {
+      break;
+    }
+
+    unsigned int vertex = this->queue.top();
+    float error = this->queue.topKey();
+
+    if (this->targetError > 0.0f && error > this->targetError) {
+      break;
+    }
+
+    // A collapse nearby could have made the chosen one invalid, the vertex picks again
+    if (!this->canCollapse(vertex, this->targets[vertex])) {
+      this->update(vertex);
+      continue;
+    }
+
+    this->collapse(vertex, this->targets[vertex]);
+    this->maxError = std::max(this->maxError, error);
+  }
+
+  MeshObject result = this->build(mesh);
+
+  std::vector<glm::dvec3>().swap(this->positions);
+  std::vector<glm::vec3>().swap(this->normals);
+  std::vector<glm::vec2>().swap(this->uvs);
+  this->table.clear();
+  std::vector<Quadric>().swap(this->quadrics);
+  std::vector<unsigned char>().swap(this->locked);
+  std::vector<unsigned char>().swap(this->removedVertices);
+  std::vector<unsigned int>().swap(this->targets);
+  this->queue.reset(0);
+
+  return result;
+};
+
+void QemSimplifier::load(MeshObject &mesh) {
+  this->positions.clear();
+  this->normals.clear();
+  this->uvs.clear();
+  this->locked.clear();
+
+  glm::dvec3 min(DBL_MAX);
+  glm::dvec3 max(-DBL_MAX);
+  for (glm::vec3 &position : mesh->position) {
+    min = glm::min(min, glm::dvec3(position));
+    max = glm::max(max, glm::dvec3(position));
+  }
+
+  this->origin = mesh->position.empty() ? glm::dvec3(0.0) : min;
+  this->uvScale = mesh->position.empty() ? 1.0 : this->uvWeight * glm::length(max - min);
+
+  // Corners with the same position, normal and UV share a vertex, a position with several of them is on a seam
+  std::vector<std::vector<unsigned int>> positionVertices(mesh->position.size());
+  std::vector<unsigned int> vertexNormals;
+  std::vector<unsigned int> vertexUVs;
+  std::vector<glm::uvec3> faces;
+
+  for (Face &face : mesh->faces) {
+    if (face.positionIndices[0] == face.positionIndices[1] || face.positionIndices[1] == face.positionIndices[2] || face.positionIndices[2] == face.positionIndices[0]) {
+      continue;
+    }
+
+    glm::uvec3 corners;
+
+    for (unsigned int i = 0; i < 3; i++) {
+      unsigned int position = face.positionIndices[i];
+      unsigned int normal = mesh->hasNormals ? face.normalIndices[i] : 0;
+      unsigned int uv = mesh->hasUVs ? face.uvIndices[i] : 0;
+
+      unsigned int vertex = (unsigned int) -1;
+      for (unsigned int candidate : positionVertices[position]) {
+        if (vertexNormals[candidate] == normal && vertexUVs[candidate] == uv) {
+          vertex = candidate;
+          break;
+        }
+      }
+
+      if (vertex == (unsigned int) -1) {
+        vertex = this->positions.size();
+
+        this->positions.push_back(glm::dvec3(mesh->position[position]) - this->origin);
+        this->normals.push_back(mesh->hasNormals ? mesh->normal[normal] : glm::vec3(0.0f));
+        this->uvs.push_back(mesh->hasUVs ? mesh->uv[uv] : glm::vec2(0.0f));
+        this->locked.push_back(0);
+
+        vertexNormals.push_back(normal);
+        vertexUVs.push_back(uv);
+        positionVertices[position].push_back(vertex);
+      }
+
+      corners[i] = vertex;
+    }
+
+    faces.push_back(corners);
+  }
+
+  for (std::vector<unsigned int> &vertices : positionVertices) {
+    if (vertices.size() > 1) {
+      for (unsigned int vertex : vertices) {
+        this->locked[vertex] = 1;
+      }
+    }
+  }
+
+  if (!this->locks.empty()) {
+    for (unsigned int vertex = 0; vertex < this->positions.size(); vertex++) {
+      if (this->locks.contains(glm::vec3(this->positions[vertex] + this->origin))) {
+        this->locked[vertex] = 1;
+      }
+    }
+  }
+
+  this->table.init(this->positions.size(), faces);
+  this->removedVertices.assign(this->positions.size(), 0);
+  this->targets.assign(this->positions.size(), 0);
+};
+
+void QemSimplifier::computeQuadrics() {
+  this->quadrics.assign(this->positions.size(), Quadric());
+
+  double p[3][QUADRIC_SIZE];
+
+  for (unsigned int f = 0; f < this->table.faceCount(); f++) {
+    glm::uvec3 face(this->table.vertex(f, 0), this->table.vertex(f, 1), this->table.vertex(f, 2));
+
+    for (unsigned int i = 0; i < 3; i++) {
+      this->point(face[i], p[i]);
+    }
+
+    glm::dvec3 a = this->positions[face[0]];
+    double area = 0.5 * glm::length(glm::cross(this->positions[face[1]] - a, this->positions[face[2]] - a));
+
+    Quadric quadric = Quadric::fromTriangle(p[0], p[1], p[2], area);
+
+    for (unsigned int i = 0; i < 3; i++) {
+      this->quadrics[face[i]].add(quadric);
+    }
+  }
+};
+
+void QemSimplifier::lockBorders() {
+  // An edge of a closed surface has two faces, the others are on a border, a seam or a non-manifold part
+  std::unordered_map<uint64_t, unsigned int> edges;
+
+  for (unsigned int c = 0; c < this->table.corners.size(); c++) {
+    unsigned int a = std::min(this->table.corners[c], this->table.corners[CornerTable::next(c)]);
+    unsigned int b = std::max(this->table.corners[c], this->table.corners[CornerTable::next(c)]);
+
+    edges[((uint64_t) a << 32) | b]++;
+  }
+
+  for (std::pair<const uint64_t, unsigned int> &edge : edges) {
+    if (edge.second != 2) {
+      this->locked[(unsigned int) (edge.first >> 32)] = 1;
+      this->locked[(unsigned int) (edge.first & 0xFFFFFFFF)] = 1;
+    }
+  }
+};
+
+void QemSimplifier::point(unsigned int vertex, double* result) {
+  result[0] = this->positions[vertex].x;
+  result[1] = this->positions[vertex].y;
+  result[2] = this->positions[vertex].z;
+  result[3] = this->uvs[vertex].x * this->uvScale;
+  result[4] = this->uvs[vertex].y * this->uvScale;
+};
+
+bool QemSimplifier::canCollapse(unsigned int from, unsigned int to) {
+  if (this->locked[from] || this->removedVertices[from] || this->removedVertices[to]) {
+    return false;
+  }
+
+  // Link condition, the vertices may share only the neighbors of the faces on their edge
+  std::vector<unsigned int> fromNeighbors;
+  std::vector<unsigned int> toNeighbors;
+  this->table.neighbors(from, fromNeighbors);
+  this->table.neighbors(to, toNeighbors);
+
+  unsigned int common = 0;
+  for (unsigned int vertex : fromNeighbors) {
+    if (std::find(toNeighbors.begin(), toNeighbors.end(), vertex) != toNeighbors.end()) {
+      common++;
+    }
+  }
+
+  unsigned int shared = 0;
+
+  for (unsigned int c = this->table.firstCorner(from); c != CORNER_NONE; c = this->table.nextCorner(c)) {
+    unsigned int f = CornerTable::face(c);
+
+    if (this->table.hasVertex(f, to)) {
+      shared++;
+      continue;
+    }
+
+    glm::uvec3 face(this->table.vertex(f, 0), this->table.vertex(f, 1), this->table.vertex(f, 2));
+
+    // The other faces move with the vertex, none of them may flip or degenerate
+    glm::dvec3 corners[3];
+    for (unsigned int i = 0; i < 3; i++) {
+      corners[i] = this->positions[face[i]];
+    }
+
+    glm::dvec3 before = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+
+    for (unsigned int i = 0; i < 3; i++) {
+      if (face[i] == from) {
+        corners[i] = this->positions[to];
+      }
+    }
+
+    glm::dvec3 after = glm::cross(corners[1] - corners[0], corners[2] - corners[0]);
+
+    double beforeLength = glm::length(before);
+    double afterLength = glm::length(after);
+
+    if (afterLength <= 0.0) {
+      return false;
+    }
+
+    if (beforeLength > 0.0 && glm::dot(before, after) < this->flipThreshold * beforeLength * afterLength) {
+      return false;
+    }
+  }
+
+  return shared > 0 && common == shared;
+};
+
+void QemSimplifier::update(unsigned int vertex) {
+  if (this->locked[vertex] || this->removedVertices[vertex]) {
+    this->queue.remove(vertex);
+    return;
+  }
+
+  std::vector<unsigned int> candidates;
+  this->table.neighbors(vertex, candidates);
+
+  double best = DBL_MAX;
+  double p[QUADRIC_SIZE];
+
+  for (unsigned int candidate : candidates) {
+    if (!this->canCollapse(vertex, candidate)) {
+      continue;
+    }
+
+    Quadric quadric = this->quadrics[vertex];
+    quadric.add(this->quadrics[candidate]);
+
+    this->point(candidate, p);
+    double error = quadric.error(p);
+    if (quadric.weight > 0.0) {
+      error /= quadric.weight;
+    }
+
+    if (error < best) {
+      best = error;
+      this->targets[vertex] = candidate;
+    }
+  }
+
+  if (best == DBL_MAX) {
+    this->queue.remove(vertex);
+  } else {
+    this->queue.set(vertex, (float) std::sqrt(best));
+  }
+};
+
+void QemSimplifier::collapse(unsigned int from, unsigned int to) {
+  // The faces of the edge are gone, the others move to the vertex
+  std::vector<unsigned int> edgeFaces;
+  for (unsigned int c = this->table.firstCorner(from); c != CORNER_NONE; c = this->table.nextCorner(c)) {
+    if (this->table.hasVertex(CornerTable::face(c), to)) {
+      edgeFaces.push_back(CornerTable::face(c));
+    }
+  }
+
+  for (unsigned int f : edgeFaces) {
+    this->table.removeFace(f);
+  }
+
+  this->table.replaceVertex(from, to);
+  this->removedVertices[from] = 1;
+  this->queue.remove(from);
+
+  this->quadrics[to].add(this->quadrics[from]);
+
+  std::vector<unsigned int> ring;
+  this->table.neighbors(to, ring);
+
+  this->update(to);
+  for (unsigned int vertex : ring) {
+    this->update(vertex);
+  }
+};
+
+MeshObject QemSimplifier::build(MeshObject &mesh) {
+  MeshObject result = MeshObject(new Mesh());
+  result->name = mesh->name;
+  result->material = mesh->material;
+
+  std::vector<unsigned int> remap(this->positions.size(), (unsigned int) -1);
+
+  for (unsigned int f = 0; f < this->table.faceCount(); f++) {
+    if (this->table.isRemoved(f)) {
+      continue;
+    }
+
+    Face face;
+
+    for (unsigned int i = 0; i < 3; i++) {
+      unsigned int vertex = this->table.vertex(f, i);
+
+      if (remap[vertex] == (unsigned int) -1) {
+        remap[vertex] = result->position.size();
+
+        result->position.push_back(glm::vec3(this->positions[vertex] + this->origin));
+        if (mesh->hasNormals) {
+          result->normal.push_back(this->normals[vertex]);
+        }
+        if (mesh->hasUVs) {
+          result->uv.push_back(this->uvs[vertex]);
+        }
+      }
+
+      face.positionIndices[i] = remap[vertex];
+      face.normalIndices[i] = mesh->hasNormals ? remap[vertex] : 0;
+      face.uvIndices[i] = mesh->hasUVs ? remap[vertex] : 0;
+    }
+
+    result->faces.push_back(face);
+  }
+
+  result->geometricError = this->maxError;
+
+  result->finish();
+  result->computeBoundingBox();
+
+  return result;
+};
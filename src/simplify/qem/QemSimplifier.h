@@ -0,0 +1,67 @@
+#ifndef __QEMSIMPLIFIER_H__
+#define __QEMSIMPLIFIER_H__
+
+#include <vector>
+#include <glm/glm.hpp>
+
+#include "./../../loaders/Loader.h"
+#include "./../../helpers/IndexedHeap.h"
+#include "./../CornerTable.h"
+#include "./../SimplifyLocks.h"
+#include "./Quadric.h"
+
+/**
+ * Quadric error metric simplifier (Garland-Heckbert) with UV-aware quadrics.
+ * A vertex is a unique position, normal and UV of the source corners, so the UV and normal seams are open borders.
+ * The border vertices are locked and the others collapse into a neighbor (half-edge collapse),
+ * the vertices keep their source attributes and the seams keep both of their sides.
+ */
+class QemSimplifier {
+  public:
+    // Faces to keep, 0 - no face target
+    unsigned int targetFaces = 0;
+    // Surface distance a collapse may reach, 0 - no error target
+    float targetError = 0.0f;
+    // Length of a UV unit relative to the mesh diagonal
+    float uvWeight = 1.0f;
+    // Minimum cosine between a face normal before and after a collapse
+    float flipThreshold = 0.2f;
+    // Vertices shared with the neighboring chunks, they are not collapsed
+    SimplifyLocks locks;
+
+    MeshObject simplify(MeshObject &mesh);
+    // The face target is shared between the meshes by their face counts
+    GroupObject simplify(GroupObject &group);
+
+  private:
+    std::vector<glm::dvec3> positions;
+    std::vector<glm::vec3> normals;
+    std::vector<glm::vec2> uvs;
+
+    CornerTable table;
+
+    std::vector<Quadric> quadrics;
+    std::vector<unsigned char> locked;
+    std::vector<unsigned char> removedVertices;
+    std::vector<unsigned int> targets;
+
+    // Vertices by the distance of their cheapest collapse
+    IndexedHeap<float> queue;
+
+    glm::dvec3 origin;
+    double uvScale = 1.0;
+    float maxError = 0.0f;
+
+    void load(MeshObject &mesh);
+    void computeQuadrics();
+    void lockBorders();
+
+    void point(unsigned int vertex, double* result);
+    bool canCollapse(unsigned int from, unsigned int to);
+    void update(unsigned int vertex);
+    void collapse(unsigned int from, unsigned int to);
+
+    MeshObject build(MeshObject &mesh);
+};
+
+#endif // __QEMSIMPLIFIER_H__
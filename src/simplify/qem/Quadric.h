@@ -0,0 +1,125 @@
+#ifndef __QUADRIC_H__
+#define __QUADRIC_H__
+
+#include <cmath>
+#include <algorithm>
+#include <glm/glm.hpp>
+
+// Position and UV
+#define QUADRIC_SIZE 5
+
+/**
+ * Garland-Heckbert quadric over a vertex with attributes (x, y, z, u, v).
+ * error(p) = p^T A p + 2 b^T p + c is the sum of the squared distances from p to the planes of the triangles in 5D,
+ * so moving a vertex off its UV chart costs the same as moving it off the surface.
+ * A is symmetric, only the upper triangle is stored.
+ */
+struct Quadric {
+  double a[QUADRIC_SIZE * (QUADRIC_SIZE + 1) / 2] = {};
+  double b[QUADRIC_SIZE] = {};
+  double c = 0.0;
+  // Sum of the triangle weights, error / weight is the mean squared distance
+  double weight = 0.0;
+
+  static unsigned int index(unsigned int i, unsigned int j) {
+    if (i > j) {
+      unsigned int t = i;
+      i = j;
+      j = t;
+    }
+
+    return i * QUADRIC_SIZE - i * (i + 1) / 2 + j;
+  };
+
+  // Quadric of the triangle plane, the weight is usually the area
+  static Quadric fromTriangle(const double* p, const double* q, const double* r, double weight) {
+    Quadric quadric;
+
+    double e1[QUADRIC_SIZE];
+    double e2[QUADRIC_SIZE];
+    double length1 = 0.0;
+
+    for (unsigned int i = 0; i < QUADRIC_SIZE; i++) {
+      e1[i] = q[i] - p[i];
+      length1 += e1[i] * e1[i];
+    }
+
+    length1 = std::sqrt(length1);
+    if (length1 <= 0.0) {
+      return quadric;
+    }
+
+    double projection = 0.0;
+    for (unsigned int i = 0; i < QUADRIC_SIZE; i++) {
+      e1[i] /= length1;
+      projection += e1[i] * (r[i] - p[i]);
+    }
+
+    double length2 = 0.0;
+    for (unsigned int i = 0; i < QUADRIC_SIZE; i++) {
+      e2[i] = r[i] - p[i] - projection * e1[i];
+      length2 += e2[i] * e2[i];
+    }
+
+    length2 = std::sqrt(length2);
+    if (length2 <= 0.0) {
+      return quadric;
+    }
+
+    double pe1 = 0.0;
+    double pe2 = 0.0;
+    double pp = 0.0;
+
+    for (unsigned int i = 0; i < QUADRIC_SIZE; i++) {
+      e2[i] /= length2;
+      pe1 += p[i] * e1[i];
+      pe2 += p[i] * e2[i];
+      pp += p[i] * p[i];
+    }
+
+    // A = I - e1 e1^T - e2 e2^T, b = (p.e1) e1 + (p.e2) e2 - p, c = p.p - (p.e1)^2 - (p.e2)^2
+    for (unsigned int i = 0; i < QUADRIC_SIZE; i++) {
+      for (unsigned int j = i; j < QUADRIC_SIZE; j++) {
+        quadric.a[index(i, j)] = weight * ((i == j ? 1.0 : 0.0) - e1[i] * e1[j] - e2[i] * e2[j]);
+      }
+
+      quadric.b[i] = weight * (pe1 * e1[i] + pe2 * e2[i] - p[i]);
+    }
+
+    quadric.c = weight * (pp - pe1 * pe1 - pe2 * pe2);
+    quadric.weight = weight;
+
+    return quadric;
+  };
+
+  void add(const Quadric &other) {
+    for (unsigned int i = 0; i < QUADRIC_SIZE * (QUADRIC_SIZE + 1) / 2; i++) {
+      this->a[i] += other.a[i];
+    }
+
+    for (unsigned int i = 0; i < QUADRIC_SIZE; i++) {
+      this->b[i] += other.b[i];
+    }
+
+    this->c += other.c;
+    this->weight += other.weight;
+  };
+
+  double error(const double* p) const {
+    double result = this->c;
+
+    for (unsigned int i = 0; i < QUADRIC_SIZE; i++) {
+      result += 2.0 * this->b[i] * p[i];
+      result += this->a[index(i, i)] * p[i] * p[i];
+
+      for (unsigned int j = i + 1; j < QUADRIC_SIZE; j++) {
+        result += 2.0 * this->a[index(i, j)] * p[i] * p[j];
+      }
+    }
+
+    // Rounding can give a tiny negative value
+    return std::max(result, 0.0);
+  };
+};
+
+#endif // __QUADRIC_H__
@@ -1,11 +1,11 @@
 #include "./simplifier.h"
 
-GroupObject simplifier::modify(GroupObject &group, float verticesCountModifier) {
+GroupObject simplifier::modify(GroupObject &group, float verticesCountModifier, const SimplifyLocks &locks) {
   GroupObject result = GroupObject(new Group());
   result->name = group->name;
 
   group->traverse([&](MeshObject mesh){
-    MeshObject target = simplifier::modify(mesh, verticesCountModifier);
+    MeshObject target = simplifier::modify(mesh, verticesCountModifier, locks);
 
     // result->geometricError += target->geometricError;
     result->meshes.push_back(target);
@@ -16,16 +16,11 @@ GroupObject simplifier::modify(GroupObject &group, float verticesCountModifier)
   return result;
 };
 
-MeshObject simplifier::modify(MeshObject &mesh, float verticesCountModifier) {
+MeshObject simplifier::modify(MeshObject &mesh, float verticesCountModifier, const SimplifyLocks &locks) {
   if (mesh->position.size() < simplifier::lowerLimit) {
     // return mesh;
   }
 
-  MeshObject resultMesh = MeshObject(new Mesh());
-  resultMesh->material = mesh->material;
-  resultMesh->name = mesh->name;
-  // resultMesh->material->diffuseMapImage = mesh->material->diffuseMapImage;
-
   // unsigned int count = floor(float(mesh->position.size()) * verticesCountModifier);
   // count = count + (3 - (count % 3));
 
@@ -33,123 +28,155 @@ MeshObject simplifier::modify(MeshObject &mesh, float verticesCountModifier) {
   //   count = mesh->position.size();
   // }
 
-  std::vector<VertexPtr> vertices;
-  std::map<unsigned int, VertexPtr> verticesMap;
-  std::vector<TrianglePtr> faces;
+  simplifier::SimplifyMesh target;
+
+  simplifier::prepare(mesh, target, locks);
+  simplifier::collapseAll(target, verticesCountModifier);
 
-  unsigned int faceId = 0;
+  return simplifier::build(mesh, target);
+};
+
+void simplifier::prepare(MeshObject &mesh, simplifier::SimplifyMesh &target, const SimplifyLocks &locks) {
+  // Source position index -> vertex, the vertices go in the order of their first corner
+  std::vector<unsigned int> verticesMap(mesh->position.size(), simplifier::noVertex);
+  std::vector<glm::uvec3> faces;
+  faces.reserve(mesh->faces.size());
+
+  target.position.clear();
+  target.normal.clear();
+  target.uv.clear();
+
+  for (Face &face : mesh->faces) {
+    glm::uvec3 triangle;
 
-  
-  for (Face face : mesh->faces) {
     for (int i = 0; i < 3; i++) {
-      if (verticesMap.find(face.positionIndices[i]) == verticesMap.end()) {
-        VertexPtr targetVertex = VertexPtr( new Vertex(mesh->position[face.positionIndices[i]]) );
-        if (mesh->hasNormals) { targetVertex->normal = mesh->normal[face.normalIndices[i]]; }
-        if (mesh->hasUVs)     { targetVertex->uv = mesh->uv[face.uvIndices[i]]; }
+      unsigned int &vertex = verticesMap[face.positionIndices[i]];
 
-        targetVertex->id = face.positionIndices[i];
+      if (vertex == simplifier::noVertex) {
+        vertex = target.position.size();
 
-        vertices.push_back(targetVertex);
-        verticesMap[face.positionIndices[i]] = targetVertex;
+        target.position.push_back(mesh->position[face.positionIndices[i]]);
+        target.normal.push_back(mesh->hasNormals ? mesh->normal[face.normalIndices[i]] : glm::vec3(0.0f));
+        target.uv.push_back(mesh->hasUVs ? mesh->uv[face.uvIndices[i]] : glm::vec2(0.0f));
       }
+
+      triangle[i] = vertex;
     }
 
-    TrianglePtr targetFace = TrianglePtr(
-      new Triangle(
-        verticesMap[face.positionIndices[0]],
-        verticesMap[face.positionIndices[1]],
-        verticesMap[face.positionIndices[2]],
-        face
-      )
-    );
-    targetFace->init();
-    targetFace->id = faceId;
-    faceId++;
-    
-    faces.push_back(targetFace);
+    faces.push_back(triangle);
   }
 
+  unsigned int vertexCount = target.position.size();
 
-  for (VertexPtr &vertex : vertices) {
-    simplifier::computeEdgeCostAtVertex(vertex);
-  }
-
-  // std::cout << "Vertex sorting started" << std::endl;
-  // std::sort(vertices.begin(), vertices.end(), [](VertexPtr &lx, VertexPtr &rx){
-  //   return lx->collapseCost < rx->collapseCost;
-  // });
+  target.table.init(vertexCount, faces);
 
-  for (unsigned int i = 0; i < vertices.size(); i++) {
-    vertices[i]->positionId = i;
+  target.faceNormal.resize(faces.size());
+  for (unsigned int i = 0; i < faces.size(); i++) {
+    simplifier::computeFaceNormal(target, i);
   }
-  // std::cout << "Vertex sorting finished" << std::endl;
 
-  
+  target.collapseCost.assign(vertexCount, 0.0f);
+  target.collapseNeighbor.assign(vertexCount, simplifier::noVertex);
+  target.geometricError.assign(vertexCount, 0.0f);
+  target.removed.assign(vertexCount, 0);
+  target.locked.assign(vertexCount, 0);
 
-  VertexPtr nextVertex;
+  if (!locks.empty()) {
+    for (unsigned int i = 0; i < vertexCount; i++) {
+      target.locked[i] = locks.contains(target.position[i]) ? 1 : 0;
+    }
+  }
 
-  nextVertex = simplifier::minimumCostEdge(vertices);
+  for (unsigned int i = 0; i < vertexCount; i++) {
+    simplifier::computeEdgeCostAtVertex(target, i);
+  }
+};
 
-  // std::cout << "Mesh simplification started" << std::endl;
+void simplifier::collapseAll(simplifier::SimplifyMesh &target, float maxCost) {
+  // Every collapse changes the costs of a few neighbors only, they are moved within the queue
+  // instead of scanning all the vertices for the next minimum
+  simplifier::CollapseQueue queue;
+  queue.reset(target.position.size());
 
-  // unsigned int processed = 0;
+  for (unsigned int i = 0; i < target.position.size(); i++) {
+    queue.set(i, target.collapseCost[i]);
+  }
 
-  while (nextVertex != NULL && nextVertex->collapseCost < verticesCountModifier) { // 50.0f //  && nextVertex->collapseCost < verticesCountModifier
-    // std::cout << "Vertex cost: " << nextVertex->collapseCost << std::endl;
-    // std::cout << "Processing, target cost: " << nextVertex->collapseCost << std::endl;
+  while (!queue.empty()) {
+    unsigned int next = queue.top();
 
-    simplifier::collapse(vertices, faces, nextVertex, nextVertex->collapseNeighbor);
+    // Removed vertices are dropped when they come up
+    if (target.removed[next]) {
+      queue.pop();
+      continue;
+    }
 
-    nextVertex = simplifier::minimumCostEdge(vertices);
-    // processed++;
+    if (target.collapseCost[next] >= maxCost) {
+      break;
+    }
 
-    // if ((processed % 100) == 0)
-    // std::cout << "Vertices processed: " << processed << std::endl;
+    queue.pop();
+    simplifier::collapse(target, next, target.collapseNeighbor[next], &queue);
   }
+};
 
-  // std::cout << "Mesh simplification has been finished" << std::endl;
+MeshObject simplifier::build(MeshObject &mesh, simplifier::SimplifyMesh &target) {
+  MeshObject resultMesh = MeshObject(new Mesh());
+  resultMesh->material = mesh->material;
+  resultMesh->name = mesh->name;
+  // resultMesh->material->diffuseMapImage = mesh->material->diffuseMapImage;
 
   resultMesh->geometricError = 0.0f;
 
-  for (unsigned int i = 0; i < vertices.size(); i++) {
-    resultMesh->position.push_back(vertices[i]->position);
+  std::vector<unsigned int> remap(target.position.size(), simplifier::noVertex);
+  unsigned int count = 0;
+
+  for (unsigned int i = 0; i < target.position.size(); i++) {
+    if (target.removed[i]) {
+      continue;
+    }
+
+    resultMesh->position.push_back(target.position[i]);
 
     if (mesh->hasNormals) {
-      resultMesh->normal.push_back(vertices[i]->normal);
+      resultMesh->normal.push_back(target.normal[i]);
     }
     if (mesh->hasUVs) {
-      resultMesh->uv.push_back(vertices[i]->uv);
+      resultMesh->uv.push_back(target.uv[i]);
     }
 
-    resultMesh->geometricError += vertices[i]->geometricError;
+    resultMesh->geometricError += target.geometricError[i];
     // resultMesh->geometricError = std::max(vertices[i]->geometricError, resultMesh->geometricError);
 
-    //vertices[i].id = i;
-    vertices[i]->positionId = i;
+    remap[i] = count++;
   }
 
-  if (vertices.size() > 0) {
-    resultMesh->geometricError /= float(vertices.size());
+  if (count > 0) {
+    resultMesh->geometricError /= float(count);
   } else {
     resultMesh->geometricError = 0.0f;
   }
 
-  for (unsigned int i = 0; i < faces.size(); i++) {
+  resultMesh->faces.reserve(target.table.liveFaces());
+
+  for (unsigned int i = 0; i < target.table.faceCount(); i++) {
+    if (target.table.isRemoved(i)) {
+      continue;
+    }
+
     Face face;
 
-    face.positionIndices[0] = faces[i]->v1->positionId;
-    face.positionIndices[1] = faces[i]->v2->positionId;
-    face.positionIndices[2] = faces[i]->v3->positionId;
+    for (unsigned int j = 0; j < 3; j++) {
+      unsigned int index = remap[target.table.vertex(i, j)];
 
-    if (mesh->hasNormals) {
-      face.normalIndices[0] = faces[i]->v1->positionId;
-      face.normalIndices[1] = faces[i]->v2->positionId;
-      face.normalIndices[2] = faces[i]->v3->positionId;
-    }
-    if (mesh->hasUVs) {
-      face.uvIndices[0] = faces[i]->v1->positionId;
-      face.uvIndices[1] = faces[i]->v2->positionId;
-      face.uvIndices[2] = faces[i]->v3->positionId;
+      face.positionIndices[j] = index;
+
+      if (mesh->hasNormals) {
+        face.normalIndices[j] = index;
+      }
+      if (mesh->hasUVs) {
+        face.uvIndices[j] = index;
+      }
     }
 
     resultMesh->faces.push_back(face);
@@ -157,276 +184,148 @@ MeshObject simplifier::modify(MeshObject &mesh, float verticesCountModifier) {
 
   resultMesh->finish();
 
-  vertices.clear();
-  faces.clear();
+  target = simplifier::SimplifyMesh();
 
   resultMesh->computeBoundingBox();
 
   return resultMesh;
 };
 
-float simplifier::computeEdgeCollapseCost(VertexPtr u, VertexPtr v) {
-  float edgeLength = glm::distance(v->position, u->position);//v->position.distanceTo(u->position);
-  float curvature  = 0.0f;
+void simplifier::computeFaceNormal(simplifier::SimplifyMesh &target, unsigned int face) {
+  glm::vec3 vA = target.position[target.table.vertex(face, 0)];
+  glm::vec3 vB = target.position[target.table.vertex(face, 1)];
+  glm::vec3 vC = target.position[target.table.vertex(face, 2)];
 
+  // Not normalized, the costs were always computed this way
+  target.faceNormal[face] = glm::cross(vC - vB, vA - vB);
+};
 
-  std::vector<TrianglePtr> sideFaces;
+float simplifier::computeEdgeCollapseCost(simplifier::SimplifyMesh &target, unsigned int u, unsigned int v) {
+  const CornerTable &table = target.table;
 
-  for (TrianglePtr &face : u->faces) // access by reference to avoid copying
-  {
-    if (face->hasVertex(v)) {
-      sideFaces.push_back(face);
-    }
-  }
+  float edgeLength = glm::distance(target.position[v], target.position[u]);
+  float curvature  = 0.0f;
 
-  for (TrianglePtr &face : u->faces) // access by reference to avoid copying
-  {
-    float minCurvature = 1.0f;
-    
-    for (TrianglePtr &sideFace : sideFaces) // access by reference to avoid copying
-    {
-      float dot = glm::dot(face->normal, sideFace->normal);//face->normal.dot(sideFace->normal);
-      minCurvature = std::min(minCurvature, (1.001f - dot) / 2.0f);
-    }
+  std::vector<unsigned int> sideFaces;
 
-    curvature = std::max(curvature, minCurvature);
+  for (unsigned int c = table.firstCorner(u); c != CORNER_NONE; c = table.nextCorner(c)) {
+    if (table.hasVertex(CornerTable::face(c), v)) {
+      sideFaces.push_back(CornerTable::face(c));
+    }
   }
 
   if (sideFaces.size() < 2) {
     // curvature = 1.0f;
     return 999999.0f;
   }
-  
-
-  return edgeLength * curvature;
-};
-
-void simplifier::computeEdgeCostAtVertex(VertexPtr v) {
-  if (v->neighbors.size() == 0) {
-    v->collapseNeighbor = NULL;
-    v->collapseCost = -0.01f;
-  } else {
-    v->collapseCost = 100000.0f;
-	  v->collapseNeighbor = NULL;
-
-    for (VertexPtr &vertex : v->neighbors) // access by reference to avoid copying
-    {
-      float collapseCost = simplifier::computeEdgeCollapseCost(v, vertex);
-
-      if (v->collapseNeighbor == NULL) {
-        v->collapseNeighbor = vertex;
-        v->collapseCost = collapseCost;
-        v->minCost = collapseCost;
-        v->totalCost = 0.0f;
-        v->costCount = 0;
-      }
 
-      v->costCount ++;
-      v->totalCost += collapseCost;
+  for (unsigned int c = table.firstCorner(u); c != CORNER_NONE; c = table.nextCorner(c)) {
+    glm::vec3 &normal = target.faceNormal[CornerTable::face(c)];
+    float minCurvature = 1.0f;
 
-      if (collapseCost < v->minCost) {
-        v->collapseNeighbor = vertex;
-        v->minCost = collapseCost;
-      }
+    for (unsigned int &sideFace : sideFaces) {
+      float dot = glm::dot(normal, target.faceNormal[sideFace]);
+      minCurvature = std::min(minCurvature, (1.001f - dot) / 2.0f);
     }
 
-    v->collapseCost = v->totalCost / float(v->costCount);
-  }
-};
-
-void simplifier::removeVertex(VertexPtr v, std::vector<VertexPtr> &vertices) {
-  while (v->neighbors.size()) {
-    VertexPtr last = v->neighbors.back();
-    v->neighbors.pop_back();
-
-    last->neighbors.erase(
-      std::remove_if(
-        last->neighbors.begin(), 
-        last->neighbors.end(),
-        [&](VertexPtr vertex){return vertex->id == v->id;}
-      ),
-      last->neighbors.end()
-    );
-
-    
+    curvature = std::max(curvature, minCurvature);
   }
 
-  vertices.erase(
-    std::remove_if(
-      vertices.begin(), 
-      vertices.end(),
-      [&](VertexPtr vertex){return vertex->id == v->id;}
-    ),
-    vertices.end()
-  );
+  return edgeLength * curvature;
 };
 
-void simplifier::removeFace(TrianglePtr f, std::vector<TrianglePtr> &faces) {
-  faces.erase(
-    std::remove_if(
-      faces.begin(),
-      faces.end(),
-      [&](TrianglePtr triangle){return triangle->id == f->id;}
-    ),
-    faces.end()
-  );
-
-  if (f->v1 != NULL) {
-    f->v1->faces.erase(
-      std::remove_if(
-        f->v1->faces.begin(), 
-        f->v1->faces.end(),
-        [&](TrianglePtr triangle){return triangle->id == f->id;}
-      ),
-      f->v1->faces.end()
-    );
-  }
+void simplifier::computeEdgeCostAtVertex(simplifier::SimplifyMesh &target, unsigned int v) {
+  target.collapseNeighbor[v] = simplifier::noVertex;
 
-  if (f->v2 != NULL) {
-    f->v2->faces.erase(
-      std::remove_if(
-        f->v2->faces.begin(), 
-        f->v2->faces.end(),
-        [&](TrianglePtr triangle){return triangle->id == f->id;}
-      ),
-      f->v2->faces.end()
-    );
+  if (target.locked[v]) {
+    target.collapseCost[v] = simplifier::lockedCost;
+    return;
   }
 
-  if (f->v3 != NULL) {
-    f->v3->faces.erase(
-      std::remove_if(
-        f->v3->faces.begin(),
-        f->v3->faces.end(),
-        [&](TrianglePtr triangle){return triangle->id == f->id;}
-      ),
-      f->v3->faces.end()
-    );
-  }
+  std::vector<unsigned int> neighbors;
+  target.table.neighbors(v, neighbors);
 
-  // TODO optimize this!
-	std::vector<VertexPtr> vs = { f->v1, f->v2, f->v3 };
-
-	for ( int i = 0; i < 3; i ++ ) {
-
-		VertexPtr v1 = vs[ i ];
-		VertexPtr v2 = vs[ ( i + 1 ) % 3 ];
-
-		if ( v1 == NULL || v2 == NULL ) continue;
+  if (neighbors.size() == 0) {
+    target.collapseCost[v] = -0.01f;
+    return;
+  }
 
-		v1->removeIfNonNeighbor( v2 );
-		v2->removeIfNonNeighbor( v1 );
+  float minCost = 0.0f;
+  float totalCost = 0.0f;
 
-	}
+  for (unsigned int &vertex : neighbors) {
+    float collapseCost = simplifier::computeEdgeCollapseCost(target, v, vertex);
 
-  /*
-  f->v1->removeIfNonNeighbor(f->v2);
-  f->v2->removeIfNonNeighbor(f->v1);
+    if (target.collapseNeighbor[v] == simplifier::noVertex || collapseCost < minCost) {
+      target.collapseNeighbor[v] = vertex;
+      minCost = collapseCost;
+    }
 
-  f->v2->removeIfNonNeighbor(f->v3);
-  f->v3->removeIfNonNeighbor(f->v2);
+    totalCost += collapseCost;
+  }
 
-  f->v3->removeIfNonNeighbor(f->v1);
-  f->v1->removeIfNonNeighbor(f->v3);
-  */
+  target.collapseCost[v] = totalCost / float(neighbors.size());
 };
 
-void simplifier::resortVertex(std::vector<VertexPtr> &vertices, VertexPtr &v, float oldCost) {
-  // positionId
-  unsigned int i = v->positionId;
-
-  if (oldCost > v->collapseCost) {
-    // New cost is smaller, move closer to start
-    i -= 1;// Take prev
-    while (i >= 0) {
-      if (vertices[i]->collapseCost < v->collapseCost) {
-        if ((i + 1) != v->positionId) {
-          unsigned int index = v->positionId;
-
-          vertices[i + 1]->positionId = v->positionId;
-          v->positionId = i + 1;
-
-          std::swap(vertices[index], vertices[i + 1]);
-        }
-
-        break;
-      }
-
-      i--;
-    }
-  } else if (oldCost > v->collapseCost) {
-    // New cost is greater, move far from start
-    i += 1;// Take next
-    while (i < vertices.size()) {
-      if (vertices[i]->collapseCost > v->collapseCost) {
-        if ((i - 1) != v->positionId) {
-          unsigned int index = v->positionId;
-
-          vertices[i - 1]->positionId = v->positionId;
-          v->positionId = i - 1;
+void simplifier::collapse(simplifier::SimplifyMesh &target, unsigned int u, unsigned int v, simplifier::CollapseQueue* queue) {
+  CornerTable &table = target.table;
 
-          std::swap(vertices[index], vertices[i - 1]);
-        }
+  if (v == simplifier::noVertex) {
+    // No faces left, so no neighbors either
+    target.removed[u] = 1;
+    return;
+  }
 
-        break;
-      }
+  std::vector<unsigned int> neighbors;
+  table.neighbors(u, neighbors);
 
-      i++;
+  // delete triangles on edge uv, the corner chain changes while they are removed
+  std::vector<unsigned int> sideFaces;
+  for (unsigned int c = table.firstCorner(u); c != CORNER_NONE; c = table.nextCorner(c)) {
+    if (table.hasVertex(CornerTable::face(c), v)) {
+      sideFaces.push_back(CornerTable::face(c));
     }
   }
-  // Else nothing changed 
-};
 
-void simplifier::collapse(std::vector<VertexPtr> &vertices, std::vector<TrianglePtr> &faces, VertexPtr u, VertexPtr v) {
-  if (v == NULL) {
-    simplifier::removeVertex(u, vertices);
-  } else {
-    std::vector<VertexPtr> tmpVertices;
-
-    for (VertexPtr &vertex : u->neighbors) // access by reference to avoid copying
-    {
-      tmpVertices.push_back(vertex);
-    }
+  for (unsigned int &face : sideFaces) {
+    table.removeFace(face);
+  }
 
-    // delete triangles on edge uv:
-    for (int i = u->faces.size() - 1; i >= 0; i --) {
-      if (u->faces[ i ]->hasVertex(v)) {
-        simplifier::removeFace(u->faces[ i ], faces);
-      }
-    }
+  // update remaining triangles to have v instead of u
+  unsigned int first = table.firstCorner(u);
+  if (first != CORNER_NONE) {
+    target.geometricError[v] = glm::distance(target.position[u], target.position[v]);
+  }
 
-    // update remaining triangles to have v instead of u
-    for (int i = u->faces.size() - 1; i >= 0; i --) {
-      // if (u->faces[ i ]->hasVertex(v)) {
-        u->faces[ i ]->replaceVertex(u, v);
-      // }
-    }
+  table.replaceVertex(u, v);
 
-    // float oldVCost = v->collapseCost;
-    // simplifier::resortVertex(vertices, v, oldVCost);
+  for (unsigned int c = first; c != CORNER_NONE; c = table.nextCorner(c)) {
+    simplifier::computeFaceNormal(target, CornerTable::face(c));
+  }
 
-    simplifier::removeVertex(u, vertices);
+  target.removed[u] = 1;
 
+  // recompute the edge collapse costs in neighborhood
+  for (unsigned int &vertex : neighbors) {
+    simplifier::computeEdgeCostAtVertex(target, vertex);
 
-    // recompute the edge collapse costs in neighborhood
-    for (VertexPtr &vertex : tmpVertices) {
-      // float oldCost = vertex->collapseCost;
-      simplifier::computeEdgeCostAtVertex(vertex); // HERE might be a bug of copying
-      // simplifier::resortVertex(vertices, vertex, oldCost);
+    if (queue != nullptr) {
+      queue->set(vertex, target.collapseCost[vertex]);
     }
   }
 };
 
-VertexPtr simplifier::minimumCostEdge(std::vector<VertexPtr> &vertices) {
-  if (vertices.size() == 0) return NULL;
+unsigned int simplifier::minimumCostEdge(simplifier::SimplifyMesh &target) {
+  unsigned int least = simplifier::noVertex;
 
-  VertexPtr least = vertices[0];
+  for (unsigned int i = 0; i < target.position.size(); i++) {
+    if (target.removed[i]) {
+      continue;
+    }
 
-  for (VertexPtr &vertex : vertices) // access by reference to avoid copying
-  {
-    if ( vertex->collapseCost < least->collapseCost ) {
-			least = vertex;
-		}
+    if (least == simplifier::noVertex || target.collapseCost[i] < target.collapseCost[least]) {
+      least = i;
+    }
   }
 
   return least;
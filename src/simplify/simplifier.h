@@ -12,6 +12,9 @@
 #include <algorithm>
 
 #include "./../loaders/Loader.h"
+#include "./../helpers/IndexedHeap.h"
+#include "./CornerTable.h"
+#include "./SimplifyLocks.h"
 
 /**
  * This was used - http://www.melax.com/polychop/
@@ -19,17 +22,51 @@
  * Implementation - https://codesandbox.io/s/23p6j1ow9j?file=/simplifyModifier.js:337-367
  */
 namespace simplifier {
+  // Vertices by collapse cost, the item is the index of the vertex
+  typedef IndexedHeap<float> CollapseQueue;
+
   static constexpr unsigned int lowerLimit = 72;
+  static constexpr unsigned int noVertex = 0xFFFFFFFFu;
+  // Cost of the locked vertices, above any limit of collapseAll
+  static constexpr float lockedCost = 1e30f;
+
+  // Mesh under simplification, a vertex is a unique source position
+  struct SimplifyMesh {
+    CornerTable table;
+
+    std::vector<glm::vec3> position;
+    std::vector<glm::vec3> normal;
+    std::vector<glm::vec2> uv;
+    // Normals of the source faces, the collapses don't update them
+    std::vector<glm::vec3> faceNormal;
+
+    std::vector<float> collapseCost;
+    std::vector<unsigned int> collapseNeighbor;
+    std::vector<float> geometricError;
+    std::vector<unsigned char> locked;
+    // Collapsed vertices stay in the arrays until build()
+    std::vector<unsigned char> removed;
+  };
+
   // GroupObject modify(GroupObject &group, unsigned int verticesToRemove);
-  GroupObject modify(GroupObject &group, float verticesCountModifier);
-  MeshObject modify(MeshObject &mesh, float verticesCountModifier);
-  float computeEdgeCollapseCost(VertexPtr u, VertexPtr v);
-  void computeEdgeCostAtVertex(VertexPtr v);
-  void removeVertex(VertexPtr v, std::vector<VertexPtr> &vertices);
-  void removeFace(TrianglePtr f, std::vector<TrianglePtr> &faces);
-  void collapse(std::vector<VertexPtr> &vertices, std::vector<TrianglePtr> &faces, VertexPtr u, VertexPtr v);
-  void resortVertex(std::vector<VertexPtr> &vertices, VertexPtr &v, float oldCost);
-  VertexPtr minimumCostEdge(std::vector<VertexPtr> &vertices);
+  // The locked vertices stay in place
+  GroupObject modify(GroupObject &group, float verticesCountModifier, const SimplifyLocks &locks = SimplifyLocks());
+  MeshObject modify(MeshObject &mesh, float verticesCountModifier, const SimplifyLocks &locks = SimplifyLocks());
+
+  // Builds the connectivity and the collapse costs
+  void prepare(MeshObject &mesh, SimplifyMesh &target, const SimplifyLocks &locks = SimplifyLocks());
+  // Collapses the cheapest vertex while its cost is below maxCost
+  void collapseAll(SimplifyMesh &target, float maxCost);
+  // Mesh of the vertices and faces that are not removed
+  MeshObject build(MeshObject &mesh, SimplifyMesh &target);
+
+  void computeFaceNormal(SimplifyMesh &target, unsigned int face);
+  float computeEdgeCollapseCost(SimplifyMesh &target, unsigned int u, unsigned int v);
+  void computeEdgeCostAtVertex(SimplifyMesh &target, unsigned int v);
+  // The queue gets the new costs of the neighbors, nullptr - no queue
+  void collapse(SimplifyMesh &target, unsigned int u, unsigned int v, CollapseQueue* queue);
+  // Linear scan, O(n) per call
+  unsigned int minimumCostEdge(SimplifyMesh &target);
 }
 
 #endif // __SIMPLIFIER_H__
\ No newline at end of file
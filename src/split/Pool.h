@@ -8,12 +8,14 @@
 // Threads
 #include <chrono>
 #include <iostream>
-#include <future>
-#include <thread>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
 
 // Regular
 #include "callback.h"
 #include "./voxel/VoxelGrid.h"
+#include "./../helpers/Scheduler.h"
 
 
 
@@ -27,138 +29,76 @@ using PoolFnTemplate = bool(Args... args);// std::shared_ptr<SplitTask>,
 // typedef std::function<PoolFn> PackagedSplit;
 
 
+/**
+ * Front-end of the shared Scheduler for one producer.
+ * Tasks run on the persistent scheduler threads, the pool only tracks its own tasks
+ * so that the producer can wait for a slot or for all of them.
+ */
 template <typename PoolFunction>
-class SplitProcess {
+class SplitPool {
   public:
     typedef std::function<PoolFunction> PackagedSplit;
 
-    bool finished = false;
-
-    std::future<bool> future;
-    std::thread thread;
-
-    template<typename... Args>
-    SplitProcess(PackagedSplit taskFn, Args... args) {
-      std::packaged_task< PoolFunction > task = std::packaged_task< PoolFunction >(taskFn);
-      this->future = task.get_future();
-      this->thread = std::thread(move(task), args...);
-    };
-
-    // SplitProcess(PackagedSplit taskFn, std::shared_ptr<SplitTask> taskObject, GridRef grid) {
-    //   std::packaged_task< PoolFunction > task = std::packaged_task< PoolFunction >(taskFn);
-    //   this->future = task.get_future();
-    //   this->thread = std::thread(move(task), taskObject, grid);
-    // };
-
-    // virtual ~SplitProcess() = default;
-
-    bool isReady() {
-      return this->future.wait_for(std::chrono::milliseconds(50)) == std::future_status::ready;
-    };
-
-    void finish() {
-      // std::cout << "Joining the task: " << this->id << std::endl;
-      this->thread.join();
-    };
-};
-
-template <typename PoolFunction>
-class SplitPool {
-  public:
-    typedef std::shared_ptr<SplitProcess<PoolFunction>> ProcessRef;
- 
-    std::vector<ProcessRef> splitResult;
+    TaskClass::Type taskClass;
 
-    unsigned int threadsUsed = 1;
     unsigned int threadsAvailable = 0;
-
     unsigned int currentTaskId = 0;
 
-    SplitPool() {
-      this->threadsAvailable = std::thread::hardware_concurrency();
+    SplitPool(TaskClass::Type taskClass = TaskClass::Voxelize) : taskClass(taskClass) {
+      this->threadsAvailable = Scheduler::GetInstance().threads();
     };
 
     virtual ~SplitPool() {
-      for (ProcessRef &task : splitResult) {
-        task->finish();
-      }
-
-      splitResult.clear();
+      this->finish();
     };
 
     bool hasSlot() {
-      return this->threadsUsed < this->threadsAvailable;
+      std::lock_guard<std::mutex> lock(this->mutex);
+      return this->pending < this->threadsAvailable;
     };
 
+    // depth - tree depth of the task, deep tasks wait when the memory is tight.
+    // A running task may create the next one, it is pending before the running one is done
     template<typename... Args>
-    void create(Args... args) {
-      std::cout << "Task id:" << (this->currentTaskId++) << std::endl;
-      // std::cout << "Push task to the pool" << std::endl;
-      ProcessRef result = std::make_shared<SplitProcess<PoolFunction>>(args...);
-      this->splitResult.push_back(result);
-    };
+    void create(unsigned int depth, PackagedSplit taskFn, Args... args) {
+      {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->currentTaskId++;
+        this->pending++;
+      }
 
-    // void create(PackagedSplit taskFn, std::shared_ptr<SplitTask> taskObject, GridRef grid) {
-    //   std::cout << "Split id: " << (this->currentTaskId++) << std::endl;
-    //   // std::cout << "Push task to the pool" << std::endl;
-    //   ProcessRef result = std::make_shared<SplitProcess<PoolFunction>>(taskFn, taskObject, grid);
-    //   this->splitResult.push_back(result);
-    // };
+      Scheduler::GetInstance().submit(this->taskClass, depth, [this, taskFn, args...]() {
+        PendingGuard guard(this);
+        taskFn(args...);
+      });
+    };
 
     void finish() {
-      std::cout << "Finishing all the threads" << std::endl;
-
-      std::vector<ProcessRef> tasksToFinish;
-
-      while (this->splitResult.size() > 0) {
-        for (ProcessRef &task : this->splitResult) {
-          if (task->isReady()) {
-            tasksToFinish.push_back(task);
-          }
-        }
-
-        for (ProcessRef &task : tasksToFinish) {
-          task->finish();
-          this->splitResult.erase(std::remove(this->splitResult.begin(), this->splitResult.end(), task), this->splitResult.end());
-        }
-
-        tasksToFinish.clear();
-
-        std::this_thread::sleep_for(std::chrono::milliseconds(300));
-      }
-
-      std::cout << "All the threads finished" << std::endl;
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->finished.wait(lock, [&]() { return this->pending == 0; });
     };
 
     void waitForSlot() {
-      if (this->splitResult.size() >= this->threadsAvailable) {
-        // std::cout << "Wait untill some task is finished" << std::endl;
-
-        std::vector<ProcessRef> tasksToFinish;
-
-        while (true) {
-          for (ProcessRef &task : this->splitResult) {
-            if (task->isReady()) {
-              tasksToFinish.push_back(task);
-            }
-          }
-
-          if (tasksToFinish.size() > 0) {
-            break;
-          }
+      std::unique_lock<std::mutex> lock(this->mutex);
+      this->finished.wait(lock, [&]() { return this->pending < this->threadsAvailable; });
+    };
 
-          std::this_thread::sleep_for(std::chrono::milliseconds(300));
-        }
+  private:
+    unsigned int pending = 0;
+    std::mutex mutex;
+    std::condition_variable finished;
 
-        // std::cout << "Tasks ready to finish: " << tasksToFinish.size() << std::endl;
+    struct PendingGuard {
+      SplitPool* pool;
 
-        for (ProcessRef &task : tasksToFinish) {
-          task->finish();
-          this->splitResult.erase(std::remove(this->splitResult.begin(), this->splitResult.end(), task), this->splitResult.end());
+      PendingGuard(SplitPool* pool) : pool(pool) {};
+      ~PendingGuard() {
+        {
+          std::lock_guard<std::mutex> lock(this->pool->mutex);
+          this->pool->pending--;
         }
-
-        tasksToFinish.clear();
-      }
+        this->pool->finished.notify_all();
+      };
     };
 };
 
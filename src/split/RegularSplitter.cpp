@@ -1,5 +1,7 @@
 #include "./RegularSplitter.h"
 
+#include <unordered_map>
+
 
 const std::string RegularSplitter::Type = "regular";
 std::shared_ptr<SplitInterface> RegularSplitter::create() {
@@ -7,6 +9,16 @@ std::shared_ptr<SplitInterface> RegularSplitter::create() {
 
   std::shared_ptr<RegularSplitter> inst = std::make_shared<RegularSplitter>();
   inst->polygonLimit = opts.limit;
+  inst->simplifier = opts.simplifier;
+  inst->simplifyChunks = opts.simplifyChunks;
+  inst->hlod = opts.hlod;
+
+  // The children of a bottom-up LOD have to meet along the borders they are merged by
+  if (inst->hlod) {
+    inst->simplifyChunks = std::max(inst->simplifyChunks, 1u);
+  }
+
+  inst->pool.taskClass = TaskClass::Simplify;
 
   return inst;
 };
@@ -14,10 +26,18 @@ std::shared_ptr<SplitInterface> RegularSplitter::create() {
 bool RegularSplitter::processLod(std::shared_ptr<RegularSplitTask> task) {
   // std::cout << "Split started" << std::endl;
 
-  GroupObject resultGroup = utils::graphics::splitUV(task->target, task->uvModifier);
+  GroupObject resultGroup;
+  {
+    SchedulerSlot slot(TaskClass::Texture);
+    resultGroup = utils::graphics::splitUV(task->target, task->uvModifier);
+  }
+
+  // The source is not needed anymore, the node is released once the recursion is done with it too
+  task->target.reset();
+  task->ticket.reset();
   resultGroup->name = std::string("Lod");
 
-  GroupObject modified = simplifier::modify(resultGroup, 500.0f);
+  GroupObject modified = this->simplify(resultGroup, task->locks);
   // this->onSave(simplifier::modify(resultGroup, 500.0f), this->IDGen.id, parent, splitLevel);
   // std::cout << "Calling callback" << std::endl;
   // modified->traverse([&](MeshObject mesh){
@@ -29,24 +49,286 @@ bool RegularSplitter::processLod(std::shared_ptr<RegularSplitTask> task) {
   // resultGroup->free(false);
   modified->free();
 
+  Progress::GetInstance().add(ProgressStage::Lod, 1, task->polygonCount);
+
   // std::cout << "Split finished" << std::endl;
 
   return false;
 };
 
+bool RegularSplitter::processHlod(std::shared_ptr<RegularSplitTask> task) {
+  std::vector<GroupObject> sources;
+  {
+    std::lock_guard<std::mutex> lock(task->mutex);
+    sources.swap(task->sources);
+  }
+
+  // The error of the LOD is on top of the largest error of its children
+  float childError = 0.0f;
+  for (GroupObject &source : sources) {
+    childError = std::max(childError, source->geometricError);
+  }
+
+  TriangleBVH bvh;
+  std::vector<glm::vec2> uvs;
+  std::vector<const Image*> images;
+  std::vector<unsigned int> triangleImages;
+  float texelSize = 0.0f;
+
+  GroupObject merged = GroupObject(new Group());
+  merged->name = std::string("Lod");
+  merged->meshes.push_back(this->merge(sources, bvh, uvs, images, triangleImages, texelSize));
+  merged->meshes[0]->material->setName(std::string("Lod") + std::to_string(task->targetId));
+
+  GroupObject modified = this->simplify(merged, task->locks);
+  merged->free(false);
+
+  bvh.build();
+
+  // The simplified mesh gets an atlas baked from the textures of the children
+  TextureBaker baker;
+  modified->traverse([&](MeshObject mesh){
+    mesh->geometricError += childError;
+    baker.bake(mesh, bvh, uvs, images, triangleImages, std::max(mesh->geometricError / baker.texelsPerError, texelSize));
+  });
+
+  task->callback(modified, task->targetId, task->parentID, task->decimationLevel, true);
+
+  for (GroupObject &source : sources) {
+    source->free();
+  }
+
+  if (task->parentTask != nullptr) {
+    this->deliver(task->parentTask, modified);
+    task->parentTask.reset();
+  } else {
+    modified->free();
+  }
+
+  Progress::GetInstance().add(ProgressStage::Lod, 1, task->polygonCount);
+
+  return false;
+};
+
+void RegularSplitter::deliver(std::shared_ptr<RegularSplitTask> task, GroupObject lod) {
+  bool ready = false;
+  {
+    std::lock_guard<std::mutex> lock(task->mutex);
+    task->sources.push_back(lod);
+    ready = --task->pending == 0;
+  }
+
+  // Runs on a worker too, so it doesn't wait for a slot
+  if (ready) {
+    this->pool.create(
+      task->decimationLevel,
+      bind(&RegularSplitter::processHlod, this, std::placeholders::_1),
+      task
+    );
+  }
+};
+
+MeshObject RegularSplitter::merge(std::vector<GroupObject> &sources, TriangleBVH &bvh, std::vector<glm::vec2> &uvs, std::vector<const Image*> &images, std::vector<unsigned int> &triangleImages, float &texelSize) {
+  MeshObject merged = MeshObject(new Mesh());
+  merged->hasNormals = true;
+
+  for (GroupObject &source : sources) {
+    source->traverse([&](MeshObject mesh){
+      merged->hasNormals = merged->hasNormals && mesh->hasNormals;
+
+      if (merged->material == nullptr && mesh->material != nullptr) {
+        merged->material = mesh->material->clone(false);
+      }
+    });
+  }
+
+  if (merged->material == nullptr) {
+    merged->material = std::make_shared<Material>();
+  }
+
+  // The children share the positions along their cuts and keep them in place, so the copies are equal
+  std::unordered_map<glm::vec3, unsigned int, LockPointHash> vertexMap;
+
+  double surfaceArea = 0.0;
+  double textureArea = 0.0;
+
+  for (GroupObject &source : sources) {
+    source->traverse([&](MeshObject mesh){
+      const Image* image = NULL;
+      if (mesh->hasUVs && mesh->material != nullptr && mesh->material->diffuseMapImage.data != NULL) {
+        image = &mesh->material->diffuseMapImage;
+      }
+
+      unsigned int imageIndex = images.size();
+      images.push_back(image);
+
+      std::vector<unsigned int> remap(mesh->position.size(), (unsigned int) -1);
+
+      for (Face &face : mesh->faces) {
+        Face target;
+        glm::vec3 corners[3];
+        glm::vec2 cornerUVs[3];
+
+        for (unsigned int i = 0; i < 3; i++) {
+          unsigned int index = face.positionIndices[i];
+          corners[i] = mesh->position[index];
+          cornerUVs[i] = mesh->hasUVs ? mesh->uv[face.uvIndices[i]] : glm::vec2(0.0f);
+
+          if (remap[index] == (unsigned int) -1) {
+            std::pair<std::unordered_map<glm::vec3, unsigned int, LockPointHash>::iterator, bool> inserted = vertexMap.insert(std::make_pair(corners[i], (unsigned int) merged->position.size()));
+            if (inserted.second) {
+              merged->position.push_back(corners[i]);
+              merged->normal.push_back(mesh->hasNormals ? mesh->normal[face.normalIndices[i]] : glm::vec3(0.0f));
+            }
+
+            remap[index] = inserted.first->second;
+          }
+
+          target.positionIndices[i] = remap[index];
+          target.normalIndices[i] = remap[index];
+          uvs.push_back(cornerUVs[i]);
+        }
+
+        // Every source triangle is baked from, even the degenerate ones
+        bvh.add(corners[0], corners[1], corners[2]);
+        triangleImages.push_back(imageIndex);
+
+        if (image != NULL) {
+          glm::vec2 du = cornerUVs[1] - cornerUVs[0];
+          glm::vec2 dv = cornerUVs[2] - cornerUVs[0];
+
+          surfaceArea += 0.5 * glm::length(glm::cross(corners[1] - corners[0], corners[2] - corners[0]));
+          textureArea += 0.5 * std::abs(du.x * dv.y - du.y * dv.x) * image->width * image->height;
+        }
+
+        if (target.positionIndices[0] == target.positionIndices[1] || target.positionIndices[1] == target.positionIndices[2] || target.positionIndices[0] == target.positionIndices[2]) {
+          continue;
+        }
+
+        merged->faces.push_back(target);
+      }
+    });
+  }
+
+  if (!merged->hasNormals) {
+    merged->normal.clear();
+  }
+
+  // The UVs are baked again after the simplification, the atlas is never finer than the textures of the children
+  merged->hasUVs = false;
+  texelSize = textureArea > 0.0 ? (float) std::sqrt(surfaceArea / textureArea) : 0.0f;
+
+  merged->computeBoundingBox();
+
+  return merged;
+};
+
+GroupObject RegularSplitter::simplify(GroupObject &group, const SimplifyLocks &locks) {
+  // A LOD tile gets as many faces as a leaf chunk, so its size doesn't depend on the detail below it
+  if (this->simplifyChunks == 0) {
+    return this->simplifyChunk(group, SimplifyLocks(), this->polygonLimit);
+  }
+
+  if (this->simplifyChunks == 1) {
+    return this->simplifyChunk(group, locks, this->polygonLimit);
+  }
+
+  // The sub-chunks aren't clipped, they share the vertices along the cut and keep them in place
+  std::vector<GroupObject> chunks = { group };
+  std::vector<SimplifyLocks> chunkLocks = { locks };
+  bool isVertical = true;
+
+  for (unsigned int count = 2; count <= this->simplifyChunks; count *= 2) {
+    std::vector<GroupObject> nextChunks;
+    std::vector<SimplifyLocks> nextLocks;
+
+    for (unsigned int i = 0; i < chunks.size(); i++) {
+      float median = this->median(chunks[i], isVertical);
+
+      GroupObject left = GroupObject(new Group());
+      GroupObject right = GroupObject(new Group());
+      SimplifyLocks shared = chunkLocks[i];
+
+      this->partition(chunks[i], isVertical, median, left, right, shared);
+
+      for (GroupObject half : { left, right }) {
+        if (half->meshes.size() != 0) {
+          nextChunks.push_back(half);
+          nextLocks.push_back(shared);
+        }
+      }
+    }
+
+    chunks.swap(nextChunks);
+    chunkLocks.swap(nextLocks);
+    isVertical = !isVertical;
+  }
+
+  std::vector<unsigned int> chunkFaces(chunks.size(), 0);
+  unsigned int totalFaces = 0;
+
+  for (unsigned int i = 0; i < chunks.size(); i++) {
+    chunks[i]->traverse([&](MeshObject mesh){
+      chunkFaces[i] += mesh->faces.size();
+    });
+
+    totalFaces += chunkFaces[i];
+  }
+
+  std::vector<GroupObject> results(chunks.size());
+
+  Scheduler::GetInstance().parallel(TaskClass::Simplify, chunks.size(), 1, [&](size_t from, size_t to) {
+    for (size_t i = from; i < to; i++) {
+      // The face limit is shared by the sub-chunk sizes
+      unsigned int targetFaces = std::max(1u, (unsigned int) ((uint64_t) this->polygonLimit * chunkFaces[i] / std::max(totalFaces, 1u)));
+
+      results[i] = this->simplifyChunk(chunks[i], chunkLocks[i], targetFaces);
+      chunks[i].reset();
+    }
+  });
+
+  GroupObject result = GroupObject(new Group());
+  result->name = group->name;
+
+  for (GroupObject &chunk : results) {
+    std::copy(chunk->meshes.begin(), chunk->meshes.end(), std::back_inserter(result->meshes));
+  }
+
+  return result;
+};
+
+GroupObject RegularSplitter::simplifyChunk(GroupObject &group, const SimplifyLocks &locks, unsigned int targetFaces) {
+  if (this->simplifier == "qem") {
+    QemSimplifier qem;
+    qem.targetFaces = targetFaces;
+    qem.locks = locks;
+
+    return qem.simplify(group);
+  }
+
+  return simplifier::modify(group, 500.0f, locks);
+};
+
+bool RegularSplitter::splitObject(GroupObject baseObject, unsigned int polygonLimit, unsigned int splitLevel, IdGenerator::ID parent, bool isVertical, const SimplifyLocks &locks, std::shared_ptr<RegularSplitTask> parentTask) {
+  // Cancelled builds stop scheduling, the running tasks are drained by finish()
+  if (Progress::GetInstance().isCancelled()) {
+    return false;
+  }
 
-bool RegularSplitter::splitObject(GroupObject baseObject, unsigned int polygonLimit, unsigned int splitLevel, IdGenerator::ID parent, bool isVertical = false) {
   unsigned int polygonCount = 0;
 
   baseObject->traverse([&](MeshObject mesh){
     polygonCount += mesh->faces.size();
   });
 
+  GeometryTicketRef ticket = std::make_shared<GeometryTicket>(splitLevel, baseObject->byteSize());
+
   // std::cout << "Simplifying: " << polygonCount << " polygons" << std::endl;
 
   // float polyModifier = polygonLimit / polygonCount;// 2048 / 48000
 
   IdGenerator::ID nextParent = parent;
+  std::shared_ptr<RegularSplitTask> task;
 
   if (polygonCount <= polygonLimit) {
     this->IDGen.next();
@@ -61,7 +343,15 @@ bool RegularSplitter::splitObject(GroupObject baseObject, unsigned int polygonLi
 
     this->onSave(resultGroup, this->IDGen.id, parent, splitLevel, false);
 
-    resultGroup->free();
+    // The parent LOD is built from the chunk and frees it
+    if (parentTask != nullptr) {
+      this->deliver(parentTask, resultGroup);
+      this->pool.waitForSlot();
+    } else {
+      resultGroup->free();
+    }
+
+    Progress::GetInstance().add(ProgressStage::Chunk, 1, polygonCount);
 
     return false;
   } else {
@@ -81,25 +371,35 @@ bool RegularSplitter::splitObject(GroupObject baseObject, unsigned int polygonLi
     // this->onSave(simplifier::modify(resultGroup, 500.0f), this->IDGen.id, parent, splitLevel);// (polygonCount / polygonLimit)
 
 
-    std::shared_ptr<RegularSplitTask> task = std::make_shared<RegularSplitTask>();
+    task = std::make_shared<RegularSplitTask>();
 
-    task->target = baseObject;
     task->targetId = nextParent;
     task->parentID = parent;
     task->decimationLevel = splitLevel;
     task->uvModifier = uvModifier;
+    task->polygonCount = polygonCount;
+    task->locks = locks;
     task->callback = this->onSave;
 
-    // std::cout << "Creating a pool task" << std::endl;
-    
-    this->pool.create(
-      bind(&RegularSplitter::processLod, this, std::placeholders::_1),
-      task
-    );
-    
-    // std::cout << "Waiting for result" << std::endl;
+    // Bottom-up, the task waits for the LODs of the children
+    if (this->hlod) {
+      task->parentTask = parentTask;
+    } else {
+      task->target = baseObject;
+      task->ticket = ticket;
+
+      // std::cout << "Creating a pool task" << std::endl;
+
+      this->pool.create(
+        splitLevel,
+        bind(&RegularSplitter::processLod, this, std::placeholders::_1),
+        task
+      );
 
-    this->pool.waitForSlot();
+      // std::cout << "Waiting for result" << std::endl;
+
+      this->pool.waitForSlot();
+    }
 
     /*
     for (unsigned int i = 2; i < 7; i++) {// 5 Levels
@@ -124,18 +424,53 @@ bool RegularSplitter::splitObject(GroupObject baseObject, unsigned int polygonLi
     //lodFn(simplifier::modify(splitter::splitUV(baseObject), 0.5f));//splitter::splitUV()
   }
 
-  float xMedian = 0.0f;
-  float zMedian = 0.0f;
+  float median = this->median(baseObject, isVertical);
+
+  GroupObject left = GroupObject(new Group());
+  GroupObject right = GroupObject(new Group());
+
+  SimplifyLocks nextLocks = locks;
+
+  if (this->hlod) {
+    // Not clipped, the halfs share the positions along the cut exactly and their parent LOD is welded by them
+    this->partition(baseObject, isVertical, median, left, right, nextLocks);
+  } else {
+    this->cut(baseObject, isVertical, median, left, right);
+    nextLocks.addPlane(isVertical ? 0 : 2, median);
+  }
+
+  // Only the pending LOD task may still hold the node, the halfs own copies of the geometry
+  baseObject.reset();
+  ticket.reset();
+
+  std::shared_ptr<RegularSplitTask> childTask;
+  if (this->hlod) {
+    // Counted before the recursion, the first half may be done before the second one is started
+    task->pending = (left->meshes.size() != 0 ? 1 : 0) + (right->meshes.size() != 0 ? 1 : 0);
+    childTask = task;
+  }
+
+  task.reset();
+
+  if (left->meshes.size() != 0) {
+    this->splitObject(std::move(left), polygonLimit, splitLevel + 1, nextParent, !isVertical, nextLocks, childTask);
+  }
+
+  if (right->meshes.size() != 0) {
+    this->splitObject(std::move(right), polygonLimit, splitLevel + 1, nextParent, !isVertical, nextLocks, childTask);
+  }
+
+  return true;
+};
+
+float RegularSplitter::median(GroupObject &baseObject, bool isVertical) {
+  float median = 0.0f;
   unsigned int verticesCount = 0;
 
   baseObject->traverse([&](MeshObject mesh){
     for (glm::vec3 &position : mesh->position) // access by reference to avoid copying
     {
-      if (isVertical) {
-        xMedian += position.x;
-      } else {
-        zMedian += position.z;
-      }
+      median += isVertical ? position.x : position.z;
     }
 
     verticesCount += mesh->position.size();
@@ -145,16 +480,11 @@ bool RegularSplitter::splitObject(GroupObject baseObject, unsigned int polygonLi
     verticesCount = 1;
   }
 
-  xMedian /= verticesCount;
-  zMedian /= verticesCount;
-
-  GroupObject left = GroupObject(new Group());
-  GroupObject right = GroupObject(new Group());
-
+  return median / verticesCount;
+};
 
+void RegularSplitter::cut(GroupObject &baseObject, bool isVertical, float median, GroupObject &left, GroupObject &right) {
   glm::vec3 pos1, pos2, pos3;
-  // unsigned int leftFaces = 0;
-  // unsigned int rightFaces = 0;
 
   bool isLeft = false;
   bool isRight = false;
@@ -170,25 +500,18 @@ bool RegularSplitter::splitObject(GroupObject baseObject, unsigned int polygonLi
       pos3 = mesh->position[face.positionIndices[2]];
 
       if (isVertical) {
-        isLeft = pos1.x <= xMedian || pos2.x <= xMedian || pos3.x <= xMedian;
-        isRight = pos1.x >= xMedian || pos2.x >= xMedian || pos3.x >= xMedian;
-
-        if (isLeft) {
-          leftMesh->faces.push_back(face);
-        }
-        if (isRight) {
-          rightMesh->faces.push_back(face);
-        }
+        isLeft = pos1.x <= median || pos2.x <= median || pos3.x <= median;
+        isRight = pos1.x >= median || pos2.x >= median || pos3.x >= median;
       } else {
-        isLeft = pos1.z <= zMedian || pos2.z <= zMedian || pos3.z <= zMedian;
-        isRight = pos1.z >= zMedian || pos2.z >= zMedian || pos3.z >= zMedian;
+        isLeft = pos1.z <= median || pos2.z <= median || pos3.z <= median;
+        isRight = pos1.z >= median || pos2.z >= median || pos3.z >= median;
+      }
 
-        if (isLeft) {
-          leftMesh->faces.push_back(face);
-        }
-        if (isRight) {
-          rightMesh->faces.push_back(face);
-        }
+      if (isLeft) {
+        leftMesh->faces.push_back(face);
+      }
+      if (isRight) {
+        rightMesh->faces.push_back(face);
       }
     }
 
@@ -215,20 +538,68 @@ bool RegularSplitter::splitObject(GroupObject baseObject, unsigned int polygonLi
     }
   });
 
-  if (left->meshes.size() != 0) { 
-    this->straightLine(left, isVertical, true, xMedian, zMedian);
-    this->splitObject(left, polygonLimit, splitLevel + 1, nextParent, !isVertical);
+  if (left->meshes.size() != 0) {
+    this->straightLine(left, isVertical, true, median, median);
   }
 
   if (right->meshes.size() != 0) {
-    this->straightLine(right, isVertical, false, xMedian, zMedian);
-    this->splitObject(right, polygonLimit, splitLevel + 1, nextParent, !isVertical);
+    this->straightLine(right, isVertical, false, median, median);
   }
-
-  return true;
 };
 
 
+void RegularSplitter::partition(GroupObject &baseObject, bool isVertical, float median, GroupObject &left, GroupObject &right, SimplifyLocks &shared) {
+  baseObject->traverse([&](MeshObject mesh){
+    MeshObject leftMesh = MeshObject(new Mesh());
+    MeshObject rightMesh = MeshObject(new Mesh());
+
+    // 1 - used by a left face, 2 - by a right one
+    std::vector<unsigned char> sides(mesh->position.size(), 0);
+
+    for (Face &face : mesh->faces) // access by reference to avoid copying
+    {
+      float centroid = 0.0f;
+      for (unsigned int i = 0; i < 3; i++) {
+        glm::vec3 &position = mesh->position[face.positionIndices[i]];
+        centroid += isVertical ? position.x : position.z;
+      }
+
+      bool isLeft = centroid / 3.0f <= median;
+
+      if (isLeft) {
+        leftMesh->faces.push_back(face);
+      } else {
+        rightMesh->faces.push_back(face);
+      }
+
+      for (unsigned int i = 0; i < 3; i++) {
+        sides[face.positionIndices[i]] |= isLeft ? 1 : 2;
+      }
+    }
+
+    for (unsigned int i = 0; i < sides.size(); i++) {
+      if (sides[i] == 3) {
+        shared.addPoint(mesh->position[i]);
+      }
+    }
+
+    for (MeshObject half : { leftMesh, rightMesh }) {
+      if (half->faces.size() == 0) {
+        continue;
+      }
+
+      half->name = mesh->name;
+      half->material = mesh->material;
+      half->hasNormals = mesh->hasNormals;
+      half->hasUVs = mesh->hasUVs;
+
+      half->remesh(mesh->position, mesh->normal, mesh->uv);
+
+      (half == leftMesh ? left : right)->meshes.push_back(half);
+    }
+  });
+};
+
 // TODO optimize a lot
 void RegularSplitter::straightLineX(MeshObject &mesh, Face &face, bool isLeft, float xValue, std::vector<glm::vec3> &position, std::vector<glm::vec3> &normal, std::vector<glm::vec2> &uv, std::vector<Face> &faces) {
   glm::vec3 pos1, pos2, pos3;
@@ -554,7 +925,7 @@ bool RegularSplitter::split(GroupObject baseObject) {
   // splitter::IDGen.reset();
   this->IDGen.reset();
 
-  this->splitObject(baseObject, this->polygonLimit, 0, this->IDGen.id, true);
+  this->splitObject(std::move(baseObject), this->polygonLimit, 0, this->IDGen.id, true, SimplifyLocks(), nullptr);
 
   return true;
 };
\ No newline at end of file
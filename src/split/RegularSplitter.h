@@ -3,6 +3,7 @@
 
 #include <vector>
 #include <map>
+#include <mutex>
 #include <iostream>
 #include <functional>
 #include <algorithm>
@@ -12,23 +13,37 @@
 
 #include "./../loaders/Loader.h"
 #include "./../simplify/simplifier.h"
+#include "./../simplify/qem/QemSimplifier.h"
 #include "./../helpers/IdGenerator.h"
+#include "./../helpers/Progress.h"
+#include "./../helpers/GeometryTracker.h"
 
 #include "./SplitBase.h"
 #include "./uvsplit.h"
+#include "./voxel/TextureBaker.h"
 
 
 class RegularSplitTask {
   public:
     GroupObject target;
+    GeometryTicketRef ticket;
 
     IdGenerator::ID targetId;
     IdGenerator::ID parentID;
     unsigned int decimationLevel;
 
     int uvModifier;
+    unsigned int polygonCount;
+    // Planes the node was cut by
+    SimplifyLocks locks;
 
     ResultCallback callback;
+
+    // Bottom-up mode: the LODs of the children, the count of the ones not done yet and the LOD they go to
+    std::vector<GroupObject> sources;
+    unsigned int pending = 0;
+    std::mutex mutex;
+    std::shared_ptr<RegularSplitTask> parentTask;
 };
 
 // typedef PoolFnTemplate<std::shared_ptr<VoxelSplitTask>, GridRef> VoxelPoolFn;
@@ -39,16 +54,36 @@ class RegularSplitter : public SplitBase<RegularPoolFn> {
   public:
     IdGenerator IDGen;
     unsigned int polygonLimit = 2048;
+    // melax or qem
+    std::string simplifier = "melax";
+    // 0 - the LOD is simplified as a whole, 1 - the vertices on the tile borders are locked,
+    // n - the LOD is also cut into up to n sub-chunks simplified in parallel
+    unsigned int simplifyChunks = 0;
+    // The LODs are built from the LODs of the children instead of the full geometry
+    bool hlod = false;
 
     bool split(GroupObject baseObject);
     // bool splitObjectOld(GroupObject baseObject, unsigned int polygonLimit, GroupCallback fn, GroupCallback lodFn, IdGenerator::ID parent, bool isVertical);
-    bool splitObject(GroupObject baseObject, unsigned int polygonLimit, unsigned int splitLevel, IdGenerator::ID parent, bool isVertical);
+    bool splitObject(GroupObject baseObject, unsigned int polygonLimit, unsigned int splitLevel, IdGenerator::ID parent, bool isVertical, const SimplifyLocks &locks, std::shared_ptr<RegularSplitTask> parentTask);
+    float median(GroupObject &baseObject, bool isVertical);
+    // The faces crossing the median go to both halfs and are clipped by it
+    void cut(GroupObject &baseObject, bool isVertical, float median, GroupObject &left, GroupObject &right);
+    // Every face goes to the side of its centroid, the positions used on both sides are added to shared
+    void partition(GroupObject &baseObject, bool isVertical, float median, GroupObject &left, GroupObject &right, SimplifyLocks &shared);
     void straightLine(GroupObject &baseObject, bool isVertical, bool isLeft, float xValue, float zValue);
     void straightLineX(MeshObject &mesh, Face &face, bool isLeft, float xValue, std::vector<glm::vec3> &position, std::vector<glm::vec3> &normal, std::vector<glm::vec2> &uv, std::vector<Face> &faces);
     void straightLineZ(MeshObject &mesh, Face &face, bool isLeft, float zValue, std::vector<glm::vec3> &position, std::vector<glm::vec3> &normal, std::vector<glm::vec2> &uv, std::vector<Face> &faces);
 
 
     bool processLod(std::shared_ptr<RegularSplitTask> task);
+    // Builds the LOD of the task from the LODs of its children
+    bool processHlod(std::shared_ptr<RegularSplitTask> task);
+    // Hands a finished LOD to the task of its parent, the last child schedules it
+    void deliver(std::shared_ptr<RegularSplitTask> task, GroupObject lod);
+    // The children merged into one mesh with the positions along their cuts welded, and the source triangles to bake from
+    MeshObject merge(std::vector<GroupObject> &sources, TriangleBVH &bvh, std::vector<glm::vec2> &uvs, std::vector<const Image*> &images, std::vector<unsigned int> &triangleImages, float &texelSize);
+    GroupObject simplify(GroupObject &group, const SimplifyLocks &locks);
+    GroupObject simplifyChunk(GroupObject &group, const SimplifyLocks &locks, unsigned int targetFaces);
 
     static const std::string Type;
     static std::shared_ptr<SplitInterface> create();
@@ -9,6 +9,9 @@ std::shared_ptr<SplitInterface> VoxelsSplitter::create() {
   inst->polygonsLimit = opts.limit;
   inst->gridSettings.gridResolution = glm::ivec3(opts.grid, opts.grid, opts.grid);
   inst->gridSettings.isoLevel = opts.iso;
+  inst->gridSettings.mesher = opts.mesher == "surfacenets" ? VoxelMesher::SurfaceNets : VoxelMesher::MarchingCubes;
+  inst->gridSettings.octree = opts.octree;
+  inst->gridSettings.bake = opts.bake;
 
   return inst;
 };
@@ -20,7 +23,11 @@ VoxelsSplitter::VoxelsSplitter() {
 bool VoxelsSplitter::split(GroupObject target) {
   this->IDGen.reset();
 
-  return this->split(target, this->IDGen.id, 0, true);
+  if (this->gridSettings.octree) {
+    this->buildOctree(target);
+  }
+
+  return this->split(std::move(target), this->IDGen.id, 0, true);
 };
 
 GroupObject VoxelsSplitter::halfMesh(GroupObject target, bool divideVertical) {
@@ -132,7 +139,17 @@ GroupObject VoxelsSplitter::halfMesh(GroupObject target, bool divideVertical) {
 GroupObject VoxelsSplitter::decimate(GroupObject target, GridRef grid) {
   GroupObject result = GroupObject(new Group());
 
-  grid->rasterize(target, result);
+  unsigned int materials = grid->rasterize(target, result);
+
+  this->gridCycles++;
+  this->savedCycles += std::max(1u, materials) - 1;
+
+  {
+    std::lock_guard<std::mutex> lock(this->errorMutex);
+    this->maxError = std::max(this->maxError, grid->hausdorffError);
+    this->squaredErrorSum += (double) grid->rmsError * (double) grid->rmsError * (double) grid->errorSamples;
+    this->errorSamples += grid->errorSamples;
+  }
 
   // result->computeUVBox();
   result->computeBoundingBox();
@@ -141,11 +158,109 @@ GroupObject VoxelsSplitter::decimate(GroupObject target, GridRef grid) {
 };
 
 
-bool VoxelsSplitter::processLod(std::shared_ptr<VoxelSplitTask> task, GridRef grid) {
+void VoxelsSplitter::buildOctree(GroupObject &target) {
+  unsigned int polygonCount = 0;
+
+  target->traverse([&](MeshObject mesh){
+    polygonCount += mesh->faces.size();
+  });
+
+  // Every split level halves the polygons, the deepest LOD node is about levels deep
+  unsigned int levels = 0;
+  while (levels < 32 && (polygonCount >> levels) > this->polygonsLimit) {
+    levels++;
+  }
+
+  unsigned int resolutionLevels = 0;
+  int resolution = std::max(this->gridSettings.gridResolution.x, std::max(this->gridSettings.gridResolution.y, this->gridSettings.gridResolution.z));
+  while ((1 << resolutionLevels) < resolution) {
+    resolutionLevels++;
+  }
+
+  // The splits go along x and z by turns, so a side of the deepest node is halved every second level
+  this->octree = std::make_shared<VoxelOctree>();
+
+  {
+    SchedulerSlot slot(TaskClass::Voxelize);
+    this->octree->build(target, resolutionLevels + (levels + 1) / 2);
+  }
+
+  std::cout << "Voxel octree: " << (this->octree->depth + 1) << " levels, " << this->octree->cellCount() << " cells" << std::endl;
+};
+
+void VoxelsSplitter::finish() {
+  SplitBase<VoxelPoolFn>::finish();
+
+  this->octree.reset();
+
+  {
+    std::lock_guard<std::mutex> lock(this->gridsMutex);
+    std::vector<GridRef>().swap(this->workerGrids);
+  }
+
+  std::cout << "Voxel grid cycles: " << this->gridCycles << ", saved by multi-material voxelization: " << this->savedCycles << std::endl;
+
+  if (this->bakedAtlases > 0) {
+    std::cout << "Baked atlases: " << this->bakedAtlases << ", " << this->bakedTexels << " texels" << std::endl;
+  }
+
+  if (this->errorSamples > 0) {
+    std::cout << "LOD error: Hausdorff " << this->maxError << ", RMS " << std::sqrt(this->squaredErrorSum / (double) this->errorSamples);
+    std::cout << " over " << this->errorSamples << " samples" << std::endl;
+  }
+};
+
+GridRef VoxelsSplitter::workerGrid() {
+  // Scheduler workers are persistent, each one keeps its grid between the LOD tasks
+  thread_local std::weak_ptr<VoxelGrid> workerGrid;
+  GridRef grid = workerGrid.lock();
+
+  if (grid == nullptr || grid->gridResolution != this->gridSettings.gridResolution) {
+    grid = std::make_shared<VoxelGrid>();
+    grid->gridResolution = this->gridSettings.gridResolution;
+    grid->init();
+    workerGrid = grid;
+
+    std::lock_guard<std::mutex> lock(this->gridsMutex);
+    this->workerGrids.push_back(grid);
+  }
+
+  grid->isoLevel = this->gridSettings.isoLevel;
+  grid->mesher = this->gridSettings.mesher;
+  grid->bake = this->gridSettings.bake;
+  grid->octree = this->octree.get();
+
+  return grid;
+};
+
+bool VoxelsSplitter::processLod(std::shared_ptr<VoxelSplitTask> task) {
   // std::cout << "Split started" << std::endl;
-  grid->init();
+  GridRef grid = this->workerGrid();
   GroupObject voxelized = this->decimate(task->target, grid);
-  utils::graphics::textureLOD(voxelized, task->textureLodLevel);
+
+  // The source is not needed anymore, the node is released once the recursion is done with it too
+  task->target.reset();
+  task->ticket.reset();
+
+  // Baked atlases belong to this LOD only, they are released once the tile is saved
+  std::vector<MaterialObject> baked;
+
+  {
+    SchedulerSlot slot(TaskClass::Texture);
+
+    if (this->gridSettings.bake) {
+      grid->bakeTextures(baked);
+
+      for (MaterialObject &material : baked) {
+        this->bakedTexels += (uint64_t) material->diffuseMapImage.width * material->diffuseMapImage.height;
+      }
+      this->bakedAtlases += baked.size();
+    } else {
+      utils::graphics::textureLOD(voxelized, task->textureLodLevel);
+    }
+  }
+
+  grid->releasePass();
   //targetMesh->material->diffuseMapImage
   // voxelized->traverse([&](MeshObject mesh){
   //   mesh->material = mesh->material->clone(false);// Without texture
@@ -156,12 +271,17 @@ bool VoxelsSplitter::processLod(std::shared_ptr<VoxelSplitTask> task, GridRef gr
 
   // std::cout << "Calling callback" << std::endl;
 
-  task->callback(voxelized, task->targetId, task->parentID, task->decimationLevel, false);
+  task->callback(voxelized, task->targetId, task->parentID, task->decimationLevel, true);
   voxelized->free(false);
 
-  // std::cout << "Split finished" << std::endl;
+  for (MaterialObject &material : baked) {
+    material->diffuseMapImage.free();
+    material->diffuseMapImage.data = NULL;
+  }
 
-  grid->free();
+  Progress::GetInstance().add(ProgressStage::Lod, 1, task->polygonCount);
+
+  // std::cout << "Split finished" << std::endl;
 
   return false;
 };
@@ -170,12 +290,19 @@ bool VoxelsSplitter::processLod(std::shared_ptr<VoxelSplitTask> task, GridRef gr
 bool VoxelsSplitter::split(GroupObject target, IdGenerator::ID parentId, unsigned int decimationLevel = 0, bool divideVertical = true) {
   // std::cout << "Split id: " << parentId << std::endl;
 
+  // Cancelled builds stop scheduling, the running tasks are drained by finish()
+  if (Progress::GetInstance().isCancelled()) {
+    return false;
+  }
+
   unsigned int polygonCount = 0;
 
   target->traverse([&](MeshObject mesh){
     polygonCount += mesh->faces.size();
   });
 
+  GeometryTicketRef ticket = std::make_shared<GeometryTicket>(decimationLevel, target->byteSize());
+
   IdGenerator::ID nextParent = parentId;
 
   if (polygonCount <= this->polygonsLimit) {
@@ -189,6 +316,8 @@ bool VoxelsSplitter::split(GroupObject target, IdGenerator::ID parentId, unsigne
       //target->name = "Chunk";
       this->onSave(resultGroup, nextParent, parentId, decimationLevel, false);
 
+      Progress::GetInstance().add(ProgressStage::Chunk, 1, polygonCount);
+
       // std::cout << "Clearing the chunk" << std::endl;
       // resultGroup->free();
     }
@@ -207,24 +336,20 @@ bool VoxelsSplitter::split(GroupObject target, IdGenerator::ID parentId, unsigne
     Options &opts = Options::GetInstance();
 
     task->target = target;
+    task->ticket = ticket;
     task->targetId = nextParent;
     task->parentID = parentId;
     task->decimationLevel = decimationLevel;
     task->textureLodLevel = opts.textureLevels;
+    task->polygonCount = polygonCount;
     task->callback = this->onSave;
 
-    // std::cout << "Creating a grid" << std::endl;
-
-    GridRef grid = std::make_shared<VoxelGrid>();
-    grid->isoLevel = this->gridSettings.isoLevel;
-    grid->gridResolution = this->gridSettings.gridResolution;
-
     // std::cout << "Creating a pool task" << std::endl;
     
     this->pool.create(
-      bind(&VoxelsSplitter::processLod, this, std::placeholders::_1, std::placeholders::_2),
-      task,
-      grid
+      decimationLevel,
+      bind(&VoxelsSplitter::processLod, this, std::placeholders::_1),
+      task
     );
     
     // std::cout << "Waiting for result" << std::endl;
@@ -252,10 +377,16 @@ bool VoxelsSplitter::split(GroupObject target, IdGenerator::ID parentId, unsigne
   
 
   GroupObject halfs = this->halfMesh(target, divideVertical);
-  // target->free();
 
-  for (GroupObject &half : halfs->children) {
-    this->split(half, nextParent, decimationLevel + 1, !divideVertical);
+  // Only the pending LOD task may still hold the node, the halfs own copies of the geometry
+  target.reset();
+  ticket.reset();
+
+  std::vector<GroupObject> children = std::move(halfs->children);
+  halfs.reset();
+
+  for (GroupObject &half : children) {
+    this->split(std::move(half), nextParent, decimationLevel + 1, !divideVertical);
   }
 
   return true;
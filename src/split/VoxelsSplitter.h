@@ -12,6 +12,8 @@
 #include <iostream>
 #include <functional>
 #include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <math.h>
 
 #include <stb/stb_image_resize.h>
@@ -26,12 +28,15 @@
 #include "./uvsplit.h"
 
 #include "./SplitBase.h"
+#include "./../helpers/Progress.h"
+#include "./../helpers/GeometryTracker.h"
 
 
 
 class VoxelSplitTask {
   public:
     GroupObject target;
+    GeometryTicketRef ticket;
 
     IdGenerator::ID targetId;
     IdGenerator::ID parentID;
@@ -40,14 +45,18 @@ class VoxelSplitTask {
     ResultCallback callback;
 
     int textureLodLevel;
+    unsigned int polygonCount;
 };
 
-typedef PoolFnTemplate<std::shared_ptr<VoxelSplitTask>, GridRef> VoxelPoolFn;
+typedef PoolFnTemplate<std::shared_ptr<VoxelSplitTask>> VoxelPoolFn;
 
 
 
 struct GridSettings {
   float isoLevel;
+  VoxelMesher::Type mesher;
+  bool octree;
+  bool bake;
   glm::ivec3 gridResolution;
 };
 
@@ -64,13 +73,38 @@ class VoxelsSplitter : public SplitBase<VoxelPoolFn> {
     unsigned int polygonsLimit = 2048;
     GridSettings gridSettings;
 
+    // Built by the top level split when gridSettings.octree is set, released by finish()
+    OctreeRef octree;
+
+    // Grids of the workers, a worker only keeps a weak reference so finish() releases them
+    std::mutex gridsMutex;
+    std::vector<GridRef> workerGrids;
+
+    // Materials of a node share one voxelization, every extra material used to cost a full grid cycle
+    std::atomic<unsigned int> gridCycles{0};
+    std::atomic<unsigned int> savedCycles{0};
+
+    // Texture atlases baked for the LOD tiles
+    std::atomic<unsigned int> bakedAtlases{0};
+    std::atomic<uint64_t> bakedTexels{0};
+
+    // Distance of the LOD surfaces to their sources over all passes
+    std::mutex errorMutex;
+    float maxError = 0.0f;
+    double squaredErrorSum = 0.0;
+    uint64_t errorSamples = 0;
+
     bool split(GroupObject target, IdGenerator::ID parentId, unsigned int decimationLevel, bool divideVertical);
     bool split(GroupObject target);
 
-    bool processLod(std::shared_ptr<VoxelSplitTask> task, GridRef grid);
+    bool processLod(std::shared_ptr<VoxelSplitTask> task);
+    GridRef workerGrid();
+    void buildOctree(GroupObject &target);
 
     GroupObject decimate(GroupObject target, GridRef grid);
     GroupObject halfMesh(GroupObject target, bool divideVertical);
+
+    void finish();
     
 
     static const std::string Type;
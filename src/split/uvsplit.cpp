@@ -4,8 +4,8 @@
 GroupObject utils::graphics::splitUV(GroupObject &baseObject, int level) {
   baseObject->computeUVBox();
 
-  // Split meshes by material name
-  std::map<std::string, GroupObject> meshMaterialMap;
+  // Split meshes by material, the ids are interned from the names
+  std::map<unsigned int, GroupObject> meshMaterialMap;
   //std::map<std::string, Material> materialMap;
 
   bool lastGroup = false;
@@ -17,11 +17,12 @@ GroupObject utils::graphics::splitUV(GroupObject &baseObject, int level) {
 
   baseObject->traverse([&](MeshObject mesh){
     // std::cout << "Mesh material name: " << mesh->material.name << std::endl;
-    if (mesh->material->name != "") {
+    if (mesh->material->id != 0) {
       GroupObject group;
+      std::map<unsigned int, GroupObject>::iterator found = meshMaterialMap.find(mesh->material->id);
 
       // Create group if doesn't exist
-      if (meshMaterialMap.find(mesh->material->name) == meshMaterialMap.end()) {
+      if (found == meshMaterialMap.end()) {
         group = GroupObject(new Group());
         group->meshes.push_back(MeshObject(new Mesh()));
 
@@ -32,7 +33,7 @@ GroupObject utils::graphics::splitUV(GroupObject &baseObject, int level) {
         group->boundingBox.min = glm::vec3(0.0f, 0.0f, 0.0f);
         group->boundingBox.max = glm::vec3(1.0f, 1.0f, 0.0f);
 
-        meshMaterialMap[mesh->material->name] = group;
+        meshMaterialMap[mesh->material->id] = group;
         //materialMap[mesh->material.name] = mesh->material;
 
         // Init full BVH tree with 3 inherite subtrees
@@ -40,7 +41,7 @@ GroupObject utils::graphics::splitUV(GroupObject &baseObject, int level) {
         createBVH( group, 0, 8);//(int) (8 - std::floor(level / 4))
         // std::cout << "BVH generation has been finished" << std::endl;
       } else {
-        group = meshMaterialMap[mesh->material->name];
+        group = found->second;
       }
 
       group->meshes[0]->position.insert(
@@ -97,7 +98,7 @@ GroupObject utils::graphics::splitUV(GroupObject &baseObject, int level) {
   // std::cout << "Splitting" << std::endl;
 
   int meshIndex = 0;
-  for (std::map<std::string, GroupObject>::iterator it = meshMaterialMap.begin(); it != meshMaterialMap.end(); ++it) {
+  for (std::map<unsigned int, GroupObject>::iterator it = meshMaterialMap.begin(); it != meshMaterialMap.end(); ++it) {
     it->second->traverse([&](MeshObject mesh){
       // std::cout << "Current mesh material name: " << mesh->material.name << std::endl;
       // std::cout << "Mesh \"" << mesh->name << "\" has: " << mesh->faces.size() << " faces" << std::endl;
@@ -255,7 +256,7 @@ GroupObject utils::graphics::splitUV(GroupObject &baseObject, int level) {
         // std::cout << "Texture clipping has been finished" << std::endl;
 
         mesh->material = mesh->material->clone(true);
-        mesh->material->name = nextName;
+        mesh->material->setName(nextName);
         mesh->material->diffuseMap = mesh->material->name + ".jpg";
         mesh->material->diffuseMapImage = diffuse;
 
@@ -281,7 +282,7 @@ GroupObject utils::graphics::splitUV(GroupObject &baseObject, int level) {
 
   // std::cout << "All groups are finished" << std::endl;
   // std::cout << "Cleaning the cached data" << std::endl;
-  for (std::map<std::string, GroupObject>::iterator it = meshMaterialMap.begin(); it != meshMaterialMap.end(); ++it) {
+  for (std::map<unsigned int, GroupObject>::iterator it = meshMaterialMap.begin(); it != meshMaterialMap.end(); ++it) {
     it->second->meshes[0]->free();
     it->second->meshes.clear();
   }
@@ -0,0 +1,376 @@
+#include "TextureBaker.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+#include "./../../helpers/Scheduler.h"
+
+glm::vec2 TextureBaker::project(glm::vec3 position, unsigned int direction) {
+  unsigned int axis = direction / 2;
+
+  return glm::vec2(position[(axis + 1) % 3], position[(axis + 2) % 3]);
+};
+
+void TextureBaker::sample(const Image &image, glm::vec2 uv, float* color) {
+  // Bilinear with repeat, the rows are stored from the top as stb loads them
+  float x = uv.x * (float) image.width - 0.5f;
+  float y = (1.0f - uv.y) * (float) image.height - 0.5f;
+
+  float fx = std::floor(x);
+  float fy = std::floor(y);
+  float tx = x - fx;
+  float ty = y - fy;
+
+  int x0 = (((int) fx % image.width) + image.width) % image.width;
+  int y0 = (((int) fy % image.height) + image.height) % image.height;
+  int x1 = (x0 + 1) % image.width;
+  int y1 = (y0 + 1) % image.height;
+
+  const unsigned char* p00 = image.data + ((size_t) y0 * image.width + x0) * image.channels;
+  const unsigned char* p10 = image.data + ((size_t) y0 * image.width + x1) * image.channels;
+  const unsigned char* p01 = image.data + ((size_t) y1 * image.width + x0) * image.channels;
+  const unsigned char* p11 = image.data + ((size_t) y1 * image.width + x1) * image.channels;
+
+  for (int c = 0; c < image.channels; c++) {
+    float top = p00[c] + (p10[c] - p00[c]) * tx;
+    float bottom = p01[c] + (p11[c] - p01[c]) * tx;
+    color[c] = top + (bottom - top) * ty;
+  }
+};
+
+void TextureBaker::expand(int from, int to, float* color) {
+  if (from >= to) {
+    return;
+  }
+
+  // 1 - gray, 2 - gray and alpha, 3 - RGB, 4 - RGBA, a missing alpha is opaque
+  float alpha = (from == 2) ? color[1] : 255.0f;
+
+  if (to == 2) {
+    color[1] = alpha;
+    return;
+  }
+
+  // Gray goes to every color channel
+  if (from < 3) {
+    color[1] = color[0];
+    color[2] = color[0];
+  }
+
+  if (to == 4) {
+    color[3] = alpha;
+  }
+};
+
+void TextureBaker::buildCharts(MeshObject &mesh, float texelSize) {
+  this->charts.clear();
+  this->faceCharts.assign(mesh->faces.size(), 0);
+
+  float chartSize = texelSize * (float) this->chartTexels;
+  glm::vec3 origin = mesh->boundingBox.min;
+
+  // A chart is a cell of the chart grid and a projection direction
+  std::unordered_map<uint64_t, unsigned int> chartMap;
+
+  for (unsigned int f = 0; f < mesh->faces.size(); f++) {
+    Face &face = mesh->faces[f];
+    glm::vec3 a = mesh->position[face.positionIndices[0]];
+    glm::vec3 b = mesh->position[face.positionIndices[1]];
+    glm::vec3 c = mesh->position[face.positionIndices[2]];
+
+    glm::vec3 normal = glm::cross(b - a, c - a);
+    glm::vec3 absNormal = glm::abs(normal);
+
+    unsigned int axis = 0;
+    if (absNormal.y > absNormal[axis]) axis = 1;
+    if (absNormal.z > absNormal[axis]) axis = 2;
+
+    unsigned int direction = axis * 2 + (normal[axis] < 0.0f ? 1 : 0);
+
+    glm::ivec3 cell = glm::ivec3(glm::floor(((a + b + c) / 3.0f - origin) / chartSize));
+    cell = glm::clamp(cell, glm::ivec3(0), glm::ivec3(0xFFFFF));
+
+    uint64_t key = (uint64_t) direction | ((uint64_t) cell.x << 3) | ((uint64_t) cell.y << 23) | ((uint64_t) cell.z << 43);
+
+    std::pair<std::unordered_map<uint64_t, unsigned int>::iterator, bool> inserted = chartMap.insert(std::make_pair(key, (unsigned int) this->charts.size()));
+    if (inserted.second) {
+      this->charts.emplace_back();
+      this->charts.back().direction = direction;
+    }
+
+    BakeChart &chart = this->charts[inserted.first->second];
+    chart.faces.push_back(f);
+    this->faceCharts[f] = inserted.first->second;
+
+    for (unsigned int i = 0; i < 3; i++) {
+      glm::vec2 point = TextureBaker::project(mesh->position[face.positionIndices[i]], direction);
+      chart.min = glm::min(chart.min, point);
+      chart.max = glm::max(chart.max, point);
+    }
+  }
+
+  for (BakeChart &chart : this->charts) {
+    glm::ivec2 texels = glm::ivec2(glm::ceil((chart.max - chart.min) / texelSize));
+    chart.size = glm::max(texels, glm::ivec2(1)) + glm::ivec2(2 * this->padding);
+  }
+};
+
+void TextureBaker::pack() {
+  // Shelf packing, the tallest charts first
+  std::vector<unsigned int> order(this->charts.size());
+  size_t area = 0;
+  int widest = 0;
+
+  for (unsigned int i = 0; i < this->charts.size(); i++) {
+    order[i] = i;
+    area += (size_t) this->charts[i].size.x * this->charts[i].size.y;
+    widest = std::max(widest, this->charts[i].size.x);
+  }
+
+  std::sort(order.begin(), order.end(), [&](unsigned int a, unsigned int b) {
+    if (this->charts[a].size.y != this->charts[b].size.y) return this->charts[a].size.y > this->charts[b].size.y;
+    return a < b;
+  });
+
+  int width = std::max(widest, (int) std::ceil(std::sqrt((double) area) * 1.1));
+  width = (width + 3) / 4 * 4;
+
+  glm::ivec2 cursor(0, 0);
+  int shelfHeight = 0;
+
+  for (unsigned int index : order) {
+    BakeChart &chart = this->charts[index];
+
+    if (cursor.x + chart.size.x > width) {
+      cursor.x = 0;
+      cursor.y += shelfHeight;
+      shelfHeight = 0;
+    }
+
+    chart.offset = cursor;
+    cursor.x += chart.size.x;
+    shelfHeight = std::max(shelfHeight, chart.size.y);
+  }
+
+  this->atlasSize = glm::ivec2(width, (cursor.y + shelfHeight + 3) / 4 * 4);
+};
+
+void TextureBaker::fill(MeshObject &mesh, BakeChart &chart, float texelSize, const TriangleBVH &bvh, const std::vector<glm::vec2> &uvs, const std::vector<const Image*> &sources, const std::vector<unsigned int> &triangleSources, int channels, unsigned char* atlas) {
+  size_t count = (size_t) chart.size.x * chart.size.y;
+
+  std::vector<float> colors(count * channels, 0.0f);
+  std::vector<unsigned char> filled(count, 0);
+
+  TriangleBVHHit hit;
+  float color[4];
+
+  for (unsigned int f : chart.faces) {
+    Face &face = mesh->faces[f];
+    glm::vec3 corners[3];
+    glm::vec2 points[3];
+
+    for (unsigned int i = 0; i < 3; i++) {
+      corners[i] = mesh->position[face.positionIndices[i]];
+      points[i] = (TextureBaker::project(corners[i], chart.direction) - chart.min) / texelSize + glm::vec2((float) this->padding);
+    }
+
+    float area = (points[1].x - points[0].x) * (points[2].y - points[0].y) - (points[2].x - points[0].x) * (points[1].y - points[0].y);
+    if (std::abs(area) < 1e-12f) {
+      continue;
+    }
+
+    glm::ivec2 from = glm::max(glm::ivec2(glm::floor(glm::min(points[0], glm::min(points[1], points[2])))), glm::ivec2(0));
+    glm::ivec2 to = glm::min(glm::ivec2(glm::ceil(glm::max(points[0], glm::max(points[1], points[2])))), chart.size - glm::ivec2(1));
+
+    for (int y = from.y; y <= to.y; y++) {
+      for (int x = from.x; x <= to.x; x++) {
+        glm::vec2 p((float) x + 0.5f, (float) y + 0.5f);
+
+        float w1 = ((p.x - points[0].x) * (points[2].y - points[0].y) - (points[2].x - points[0].x) * (p.y - points[0].y)) / area;
+        float w2 = ((points[1].x - points[0].x) * (p.y - points[0].y) - (p.x - points[0].x) * (points[1].y - points[0].y)) / area;
+        float w0 = 1.0f - w1 - w2;
+
+        if (w0 < 0.0f || w1 < 0.0f || w2 < 0.0f) {
+          continue;
+        }
+
+        glm::vec3 point = corners[0] * w0 + corners[1] * w1 + corners[2] * w2;
+        if (!bvh.closestPoint(point, hit)) {
+          continue;
+        }
+
+        const Image* source = sources[triangleSources.empty() ? 0 : triangleSources[hit.triangle]];
+        if (source == NULL) {
+          continue;
+        }
+
+        const glm::vec2 &a = uvs[hit.triangle * 3];
+        const glm::vec2 &b = uvs[hit.triangle * 3 + 1];
+        const glm::vec2 &c = uvs[hit.triangle * 3 + 2];
+
+        TextureBaker::sample(*source, a * (1.0f - hit.barycentric.x - hit.barycentric.y) + c * hit.barycentric.x + b * hit.barycentric.y, color);
+        TextureBaker::expand(source->channels, channels, color);
+
+        size_t texel = (size_t) y * chart.size.x + x;
+        std::copy(color, color + channels, &colors[texel * channels]);
+        filled[texel] = 1;
+      }
+    }
+  }
+
+  // The texels around the faces take the colors of their neighbors, filtering and mip levels don't bleed the other charts in
+  for (unsigned int pass = 0; pass <= this->padding; pass++) {
+    std::vector<unsigned char> next = filled;
+
+    for (int y = 0; y < chart.size.y; y++) {
+      for (int x = 0; x < chart.size.x; x++) {
+        size_t texel = (size_t) y * chart.size.x + x;
+        if (filled[texel]) {
+          continue;
+        }
+
+        const int neighbors[4][2] = { {-1, 0}, {1, 0}, {0, -1}, {0, 1} };
+        for (unsigned int n = 0; n < 4; n++) {
+          int nx = x + neighbors[n][0];
+          int ny = y + neighbors[n][1];
+
+          if (nx < 0 || ny < 0 || nx >= chart.size.x || ny >= chart.size.y) {
+            continue;
+          }
+
+          size_t neighbor = (size_t) ny * chart.size.x + nx;
+          if (filled[neighbor]) {
+            std::copy(&colors[neighbor * channels], &colors[neighbor * channels] + channels, &colors[texel * channels]);
+            next[texel] = 1;
+            break;
+          }
+        }
+      }
+    }
+
+    filled.swap(next);
+  }
+
+  for (int y = 0; y < chart.size.y; y++) {
+    // The atlas is written from the top row like the source images
+    int row = this->atlasSize.y - 1 - (chart.offset.y + y);
+    unsigned char* target = atlas + ((size_t) row * this->atlasSize.x + chart.offset.x) * channels;
+
+    for (size_t i = 0; i < (size_t) chart.size.x * channels; i++) {
+      target[i] = (unsigned char) std::min(255.0f, std::max(0.0f, colors[(size_t) y * chart.size.x * channels + i] + 0.5f));
+    }
+  }
+};
+
+bool TextureBaker::bake(MeshObject &mesh, const TriangleBVH &bvh, const std::vector<glm::vec2> &uvs, float texelSize) {
+  if (!mesh->hasUVs || mesh->material == nullptr) {
+    return false;
+  }
+
+  return this->bake(mesh, bvh, uvs, { &mesh->material->diffuseMapImage }, std::vector<unsigned int>(), texelSize);
+};
+
+bool TextureBaker::bake(MeshObject &mesh, const TriangleBVH &bvh, const std::vector<glm::vec2> &uvs, const std::vector<const Image*> &sources, const std::vector<unsigned int> &triangleSources, float texelSize) {
+  if (mesh->material == nullptr || mesh->faces.size() == 0) {
+    return false;
+  }
+
+  // Sources without usable data aren't sampled, the atlas takes the most channels of the others
+  std::vector<const Image*> images(sources.size(), NULL);
+  int channels = 0;
+
+  for (unsigned int i = 0; i < sources.size(); i++) {
+    if (sources[i] != NULL && sources[i]->data != NULL && sources[i]->channels >= 1 && sources[i]->channels <= 4) {
+      images[i] = sources[i];
+      channels = std::max(channels, sources[i]->channels);
+    }
+  }
+
+  if (channels == 0) {
+    return false;
+  }
+
+  mesh->computeBoundingBox();
+  float diagonal = glm::length(mesh->boundingBox.getSize());
+
+  if (!(texelSize > 0.0f)) {
+    texelSize = diagonal / (float) this->maxSize;
+  }
+
+  // The texels grow until the atlas fits
+  for (unsigned int attempt = 0; attempt < 16; attempt++) {
+    this->buildCharts(mesh, texelSize);
+    this->pack();
+
+    int side = std::max(this->atlasSize.x, this->atlasSize.y);
+    if (side <= (int) this->maxSize) {
+      break;
+    }
+
+    texelSize *= std::max(1.1f, (float) side / (float) this->maxSize);
+  }
+
+  // A vertex is split only where charts meet
+  std::vector<glm::vec3> positions;
+  std::vector<glm::vec3> normals;
+  std::vector<glm::vec2> atlasUVs;
+  std::unordered_map<uint64_t, unsigned int> vertexMap;
+
+  std::vector<Face> faces = mesh->faces;
+
+  for (unsigned int f = 0; f < faces.size(); f++) {
+    BakeChart &chart = this->charts[this->faceCharts[f]];
+
+    for (unsigned int i = 0; i < 3; i++) {
+      unsigned int vertex = faces[f].positionIndices[i];
+      uint64_t key = (uint64_t) vertex * this->charts.size() + this->faceCharts[f];
+
+      std::pair<std::unordered_map<uint64_t, unsigned int>::iterator, bool> inserted = vertexMap.insert(std::make_pair(key, (unsigned int) positions.size()));
+
+      if (inserted.second) {
+        glm::vec2 texel = (TextureBaker::project(mesh->position[vertex], chart.direction) - chart.min) / texelSize;
+        texel += glm::vec2(chart.offset) + glm::vec2((float) this->padding);
+
+        positions.push_back(mesh->position[vertex]);
+        normals.push_back(mesh->hasNormals ? mesh->normal[faces[f].normalIndices[i]] : glm::vec3(0.0f));
+        atlasUVs.push_back(texel / glm::vec2(this->atlasSize));
+      }
+
+      faces[f].positionIndices[i] = inserted.first->second;
+      faces[f].normalIndices[i] = inserted.first->second;
+      faces[f].uvIndices[i] = inserted.first->second;
+    }
+  }
+
+  // Allocated like the stb images, Image::free releases it
+  size_t bytes = (size_t) this->atlasSize.x * this->atlasSize.y * channels;
+  unsigned char* atlas = (unsigned char*) std::malloc(bytes);
+  std::memset(atlas, 0, bytes);
+
+  Scheduler::GetInstance().parallel(TaskClass::Texture, this->charts.size(), 16, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      this->fill(mesh, this->charts[i], texelSize, bvh, uvs, images, triangleSources, channels, atlas);
+    }
+  });
+
+  MaterialObject material = mesh->material->clone(true);
+  material->setName(mesh->material->name + "_baked");
+  material->diffuseMap = material->name + ".jpg";
+  material->diffuseMapImage.width = this->atlasSize.x;
+  material->diffuseMapImage.height = this->atlasSize.y;
+  material->diffuseMapImage.channels = channels;
+  material->diffuseMapImage.data = atlas;
+
+  mesh->position.swap(positions);
+  mesh->normal.swap(normals);
+  mesh->uv.swap(atlasUVs);
+  mesh->faces.swap(faces);
+  mesh->material = material;
+  mesh->hasUVs = true;
+  mesh->computeUVBox();
+
+  return true;
+};
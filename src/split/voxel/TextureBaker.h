@@ -0,0 +1,61 @@
+#ifndef __TEXTUREBAKER_H__
+#define __TEXTUREBAKER_H__
+
+#include <vector>
+#include <cstdint>
+#include <cfloat>
+#include <glm/glm.hpp>
+
+#include "./../../loaders/Loader.h"
+#include "./../../helpers/TriangleBVH.h"
+
+struct BakeChart {
+  // Projection axis and the side of the surface, 0..5
+  unsigned int direction = 0;
+  std::vector<unsigned int> faces;
+
+  // Projected bounds in world units
+  glm::vec2 min = glm::vec2(FLT_MAX);
+  glm::vec2 max = glm::vec2(-FLT_MAX);
+
+  // Texels with the padding and the place in the atlas
+  glm::ivec2 size;
+  glm::ivec2 offset;
+};
+
+/**
+ * Bakes a dedicated texture atlas for a LOD mesh.
+ * Faces are grouped into small charts projected along their dominant axis, so the vertices stay shared inside a chart.
+ * A texel is filled from the source texture at the closest point of the source surface.
+ */
+class TextureBaker {
+  public:
+    // The texel size is usually the geometric error divided by this
+    float texelsPerError = 4.0f;
+    // A chart covers a cube of this many texels
+    unsigned int chartTexels = 32;
+    unsigned int padding = 2;
+    unsigned int maxSize = 2048;
+
+    // Replaces the UVs and the material of the mesh, false when there is no texture to bake
+    bool bake(MeshObject &mesh, const TriangleBVH &bvh, const std::vector<glm::vec2> &uvs, float texelSize);
+    // The triangle t of the BVH is sampled from sources[triangleSources[t]], a null source is left to the padding.
+    // All the triangles use sources[0] when triangleSources is empty
+    bool bake(MeshObject &mesh, const TriangleBVH &bvh, const std::vector<glm::vec2> &uvs, const std::vector<const Image*> &sources, const std::vector<unsigned int> &triangleSources, float texelSize);
+
+  private:
+    std::vector<BakeChart> charts;
+    std::vector<unsigned int> faceCharts;
+    glm::ivec2 atlasSize;
+
+    void buildCharts(MeshObject &mesh, float texelSize);
+    void pack();
+    void fill(MeshObject &mesh, BakeChart &chart, float texelSize, const TriangleBVH &bvh, const std::vector<glm::vec2> &uvs, const std::vector<const Image*> &sources, const std::vector<unsigned int> &triangleSources, int channels, unsigned char* atlas);
+
+    static glm::vec2 project(glm::vec3 position, unsigned int direction);
+    static void sample(const Image &image, glm::vec2 uv, float* color);
+    // Converts a sample of a source with fewer channels to the layout of the atlas
+    static void expand(int from, int to, float* color);
+};
+
+#endif // __TEXTUREBAKER_H__
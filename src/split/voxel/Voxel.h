@@ -11,29 +11,28 @@
 
 class Voxel {
   public:
-    std::vector<VoxelFacePtr> faces;
+    // Indices of the crossing faces in the flat face array of the pass
+    std::vector<unsigned int> faces;
 
     std::vector<VoxelFaceTriangle> resultTriangles;
 
-    glm::vec3 voxelVertices[8];
-
     glm::ivec3 position;
-    glm::vec3 units;
-    float geometricError = 0.0f;
 
     glm::vec3 averageNormal;
 
-    Voxel(glm::ivec3 position, glm::vec3 units, glm::vec3 offset);
+    // Crossed by the surface, the other voxels only hold the triangles of their cube
+    bool occupied = false;
 
-    glm::vec2 getClosestUV(glm::vec3 p);
+    // Corners are not stored, VoxelGrid::getVoxelVertex computes them from the position
+    void reset(glm::ivec3 position);
 
-    bool has(VoxelFacePtr &face);
+    bool has(unsigned int face);
     bool intersects(glm::vec3 from, glm::vec3 to);
-    void computeError();
 
     virtual ~Voxel();
 };
 
-typedef std::shared_ptr<Voxel> VoxelPtr;
+// Points into the grid storage, valid until the grid is cleared
+typedef Voxel* VoxelPtr;
 
 #endif // __VOXEL_H__
\ No newline at end of file
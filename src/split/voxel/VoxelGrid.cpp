@@ -295,6 +295,17 @@ const int VoxelGrid::triTable[256][16] = {
 	{-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1}
 };
 
+const int VoxelGrid::cornerTable[8][3] = {
+  {0, 0, 0}, {1, 0, 0}, {1, 1, 0}, {0, 1, 0},
+  {0, 0, 1}, {1, 0, 1}, {1, 1, 1}, {0, 1, 1}
+};
+
+const int VoxelGrid::edgeCorners[12][2] = {
+  {0, 1}, {1, 2}, {2, 3}, {3, 0},
+  {4, 5}, {5, 6}, {6, 7}, {7, 4},
+  {0, 4}, {1, 5}, {2, 6}, {3, 7}
+};
+
 bool VoxelGrid::isFirst(unsigned int x, unsigned int y, unsigned int z, glm::ivec3 n) {
   int i = 1;
   glm::ivec3 pos = glm::ivec3(x, y, z) + (n * i);
@@ -367,98 +378,27 @@ VoxelPtr VoxelGrid::getNeighbor(unsigned int x, unsigned int y, unsigned int z,
   return this->get(x, y, z);
 };
 
-void VoxelGrid::getClosestUV(VoxelFaceTriangle &triangle, glm::ivec3 voxelPos) {
-  glm::vec3 triCenter = triangle.a.position + triangle.b.position + triangle.c.position;
-  triCenter /= 3.0f;
-
-  VoxelFacePtr resFacePtr = nullptr;
-  float dist = 999999.0f;
-
-  int maxStep = 1;
-  int minStep = -maxStep;
-
-  for (int i = minStep; i <= maxStep; i++) {
-    for (int k = minStep; k <= maxStep; k++) {
-      for (int m = minStep; m <= maxStep; m++) {
-        if (this->has(voxelPos.x + i, voxelPos.y + k, voxelPos.z + m)) {
-          VoxelPtr voxel = this->get(voxelPos.x + i, voxelPos.y + k, voxelPos.z + m);
-          for (VoxelFacePtr &facePtr : voxel->faces) {
-            glm::vec3 sampleTriCenter = facePtr->vertices[0].position + facePtr->vertices[1].position + facePtr->vertices[2].position;
-            sampleTriCenter /= 3.0f;
-            
-            float dt = glm::distance(sampleTriCenter, triCenter);
-            if (dt <= dist) {
-              dist = dt;
-              resFacePtr = facePtr;
-            }
-          }
-        }
-      }
-    }
-  }
+glm::vec3 VoxelGrid::getVoxelVertex(unsigned int x, unsigned int y, unsigned int z, unsigned int index) {
+  glm::vec3 corner(
+    (float) (x + VoxelGrid::cornerTable[index][0]),
+    (float) (y + VoxelGrid::cornerTable[index][1]),
+    (float) (z + VoxelGrid::cornerTable[index][2])
+  );
 
-  if (resFacePtr != nullptr) {
-    triangle.a.uv = resFacePtr->vertices[0].uv;
-    triangle.b.uv = resFacePtr->vertices[1].uv;
-    triangle.c.uv = resFacePtr->vertices[2].uv;
-  }
+  return corner * this->units + this->gridOffset;
 };
 
-glm::vec2 VoxelGrid::getClosestUV(glm::ivec3 voxelPos, glm::vec3 pos) {
-  glm::vec2 result;
-  float dist = 999999.0f;
-
-  glm::vec3 tpos = pos;
-
-  int maxStep = 1;
-  int minStep = -maxStep;
-
-  for (int i = minStep; i <= maxStep; i++) {
-    for (int k = minStep; k <= maxStep; k++) {
-      for (int m = minStep; m <= maxStep; m++) {
-        if (this->has(voxelPos.x + i, voxelPos.y + k, voxelPos.z + m)) {
-          VoxelPtr voxel = this->get(voxelPos.x + i, voxelPos.y + k, voxelPos.z + m);
-          for (VoxelFacePtr &facePtr : voxel->faces) {
-            // math::clothestTrianglePointOld
-
-            Vec3Result vecRes = math::clothestTrianglePointOld(
-              tpos,
-              facePtr->vertices[0].position,
-              facePtr->vertices[1].position,
-              facePtr->vertices[2].position
-            );
-
-            if (vecRes.hasData) {
-              float dt = glm::distance(vecRes.data, tpos);
-              if (dt <= dist) {
-                dist = dt;
-                result = vecRes.uv;//facePtr->vertices[0].uv.toGLM();
-                // result = voxelFaceVertex.uv.toGLM();
-              }
-            }
-            
-            /*
-            for (unsigned int t = 0; t < 3; t++) {
-              VoxelFaceVertex &voxelFaceVertex = facePtr->vertices[t];
-
-              float dt = voxelFaceVertex.position.distanceTo(tpos);
-              if (dt <= dist) {
-                dist = dt;
-                result = voxelFaceVertex.uv.toGLM();
-              }
-            }
-            */
-          }
-        }
-      }
-    }
-  }
+uint64_t VoxelGrid::getEdgeKey(unsigned int x, unsigned int y, unsigned int z, unsigned int edge) {
+  const int* from = VoxelGrid::cornerTable[VoxelGrid::edgeCorners[edge][0]];
+  const int* to = VoxelGrid::cornerTable[VoxelGrid::edgeCorners[edge][1]];
 
-  return result;
-};
+  // An edge is its lower grid point plus the axis it goes along, whichever cell it was reached from
+  uint64_t startX = x + std::min(from[0], to[0]);
+  uint64_t startY = y + std::min(from[1], to[1]);
+  uint64_t startZ = z + std::min(from[2], to[2]);
+  uint64_t axis = (from[0] != to[0]) ? 0 : ((from[1] != to[1]) ? 1 : 2);
 
-glm::vec3 VoxelGrid::getVoxelVertex(unsigned int x, unsigned int y, unsigned int z, unsigned int index) {
-  return this->get(x, y, z)->voxelVertices[index];
+  return ((startX * (this->gridResolution.y + 1) + startY) * (this->gridResolution.z + 1) + startZ) * 3 + axis;
 };
 
 glm::vec3 VoxelGrid::intLinear(glm::vec3 p1, glm::vec3 p2, float valp1, float valp2) {
@@ -487,8 +427,100 @@ glm::vec3 VoxelGrid::intLinear(glm::vec3 p1, glm::vec3 p2, float valp1, float va
   );
 };
 
+VoxelBrick* VoxelGrid::getBrick(unsigned int x, unsigned int y, unsigned int z) {
+  uint64_t key = brickKey(x, y, z);
+  if (key == this->cachedKey) {
+    return &this->bricks[this->cachedBrick];
+  }
+
+  std::unordered_map<uint64_t, unsigned int>::iterator it = this->brickMap.find(key);
+  if (it == this->brickMap.end()) {
+    return nullptr;
+  }
+
+  this->cachedKey = key;
+  this->cachedBrick = it->second;
+
+  return &this->bricks[it->second];
+};
+
+VoxelBrick* VoxelGrid::touchBrick(unsigned int x, unsigned int y, unsigned int z) {
+  std::pair<std::unordered_map<uint64_t, unsigned int>::iterator, bool> inserted = this->brickMap.insert(std::make_pair(brickKey(x, y, z), this->brickCount));
+
+  if (inserted.second) {
+    if (this->brickCount == this->bricks.size()) {
+      this->bricks.emplace_back();
+      std::fill(std::begin(this->bricks.back().slots), std::end(this->bricks.back().slots), 0);
+    }
+
+    const unsigned int mask = ~((unsigned int) VOXEL_BRICK_SIZE - 1);
+    this->bricks[this->brickCount].origin = glm::ivec3(x & mask, y & mask, z & mask);
+    this->brickCount++;
+  }
+
+  return &this->bricks[inserted.first->second];
+};
+
+void VoxelGrid::collectActiveCells() {
+  this->activeCells.clear();
+  this->activeCells.reserve(this->voxelCount * 2);
+
+  // Marching cubes reads the corners at +1, so the cube at -1 of an occupied cell can be crossed by the surface too
+  for (unsigned int v = 0; v < this->voxelCount; v++) {
+    glm::ivec3 &position = this->voxels[v].position;
+
+    for (unsigned int i = 0; i < 8; i++) {
+      glm::ivec3 cell(
+        position.x - VoxelGrid::cornerTable[i][0],
+        position.y - VoxelGrid::cornerTable[i][1],
+        position.z - VoxelGrid::cornerTable[i][2]
+      );
+
+      // The cubes below the slab belong to the previous one, the layer at slabEnd is only read
+      if (cell.x >= 0 && cell.y >= 0 && cell.z >= this->slabBegin && cell.z < this->slabEnd) {
+        this->activeCells.push_back(cell);
+      }
+    }
+  }
+
+  // The same order as a full grid sweep in z, y, x, so the output depends neither on the voxelization order nor on the slabs
+  std::sort(this->activeCells.begin(), this->activeCells.end(), [](const glm::ivec3 &a, const glm::ivec3 &b) {
+    if (a.z != b.z) return a.z < b.z;
+    if (a.y != b.y) return a.y < b.y;
+    return a.x < b.x;
+  });
+
+  this->activeCells.erase(std::unique(this->activeCells.begin(), this->activeCells.end()), this->activeCells.end());
+};
+
 VoxelPtr VoxelGrid::get(unsigned int x, unsigned int y, unsigned int z) {
-  return this->data[x][y][z];
+  if (this->isOutOfGrid(x, y, z)) {
+    return nullptr;
+  }
+
+  VoxelBrick* brick = this->getBrick(x, y, z);
+  if (brick == nullptr) {
+    return nullptr;
+  }
+
+  unsigned int slot = brick->slots[brickCell(x, y, z)];
+
+  return (slot == 0) ? nullptr : &this->voxels[slot - 1];
+};
+
+VoxelPtr VoxelGrid::touch(unsigned int x, unsigned int y, unsigned int z) {
+  unsigned int &slot = this->touchBrick(x, y, z)->slots[brickCell(x, y, z)];
+
+  if (slot == 0) {
+    if (this->voxelCount == this->voxels.size()) {
+      this->voxels.emplace_back();
+    }
+
+    this->voxels[this->voxelCount].reset(glm::ivec3(x, y, z));
+    slot = ++this->voxelCount;
+  }
+
+  return &this->voxels[slot - 1];
 };
 
 bool VoxelGrid::hasTriangles(unsigned int x, unsigned int y, unsigned int z) {
@@ -496,9 +528,9 @@ bool VoxelGrid::hasTriangles(unsigned int x, unsigned int y, unsigned int z) {
     return false;
   }
 
-  VoxelPtr voxel = this->data[x][y][z];
+  VoxelPtr voxel = this->get(x, y, z);
 
-  if (voxel == NULL) {
+  if (voxel == nullptr) {
     return false;
   }
 
@@ -510,24 +542,26 @@ bool VoxelGrid::has(unsigned int x, unsigned int y, unsigned int z) {
     return false;
   }
 
-  VoxelPtr voxel = this->data[x][y][z];
+  VoxelPtr voxel = this->get(x, y, z);
 
-  if (voxel == NULL) {
+  if (voxel == nullptr) {
     return false;
   }
 
-  return (voxel->faces.size() > 0);
+  return voxel->occupied;
 };
 
-void VoxelGrid::set(VoxelPtr &ptr, unsigned int x, unsigned int y, unsigned int z) {
-  this->data[x][y][z] = ptr;
+void VoxelGrid::setSpace(glm::vec3 offset, glm::vec3 units) {
+  this->gridOffset = offset;
+  this->units = units;
+  this->inverseUnits = glm::vec3(1.0f) / units;
 };
 
 glm::ivec3 VoxelGrid::vecToGrid(float x, float y, float z) {
   glm::ivec3 position(
-    (unsigned int) std::floor((x - this->gridOffset.x) / this->units.x),
-    (unsigned int) std::floor((y - this->gridOffset.y) / this->units.y),
-    (unsigned int) std::floor((z - this->gridOffset.z) / this->units.z)
+    GridMath::fastFloor((x - this->gridOffset.x) * this->inverseUnits.x),
+    GridMath::fastFloor((y - this->gridOffset.y) * this->inverseUnits.y),
+    GridMath::fastFloor((z - this->gridOffset.z) * this->inverseUnits.z)
   );
 
   position.x = std::min(this->gridResolution.x - 1, std::max(0, position.x));
@@ -537,6 +571,10 @@ glm::ivec3 VoxelGrid::vecToGrid(float x, float y, float z) {
   return position;
 };
 
+void VoxelGrid::toGridSpace(const glm::vec3* points, glm::vec3* result, size_t count) {
+  GridMath::toGridSpace(this->gridOffset, this->inverseUnits, points, result, count);
+};
+
 glm::vec3 VoxelGrid::gridToVec(unsigned int x, unsigned int y, unsigned int z) {
   return glm::vec3(
     x * this->units.x + this->gridOffset.x,
@@ -604,8 +642,6 @@ bool VoxelGrid::lastOfZ(int cellX, int cellY, int cellZ) {
 
 
 float VoxelGrid::getIntValue(unsigned int x, unsigned int y, unsigned int z) {
-  unsigned int faces = std::min((unsigned int) 32, (unsigned int) this->get(x, y, z)->faces.size());
-
   return 0.5f;
 
   // return ((float) faces) / 32.0f;
@@ -631,13 +667,7 @@ float VoxelGrid::getIntValue(unsigned int x, unsigned int y, unsigned int z, uns
   // return ((float) faces) / this->facesBox.y;
 };
 
-std::vector<VoxelFaceTriangle> VoxelGrid::getVertices(unsigned int x, unsigned int y, unsigned int z) {
-  std::vector<VoxelFaceTriangle> result;
-
-  /*
-   * Determine the index into the edge table which
-   * tells us which vertices are inside of the surface
-   */
+unsigned int VoxelGrid::getCubeIndex(unsigned int x, unsigned int y, unsigned int z) {
   unsigned int cubeindex = 0;
   if (this->hasNeighbor(x, y, z, 0)) cubeindex |= 1;
   if (this->hasNeighbor(x, y, z, 1)) cubeindex |= 2;
@@ -648,6 +678,130 @@ std::vector<VoxelFaceTriangle> VoxelGrid::getVertices(unsigned int x, unsigned i
   if (this->hasNeighbor(x, y, z, 6)) cubeindex |= 64;
   if (this->hasNeighbor(x, y, z, 7)) cubeindex |= 128;
 
+  return cubeindex;
+};
+
+uint64_t VoxelGrid::getCellKey(unsigned int x, unsigned int y, unsigned int z) {
+  return ((uint64_t) x * (this->gridResolution.y + 1) + y) * (this->gridResolution.z + 1) + z;
+};
+
+bool VoxelGrid::getNetVertex(unsigned int x, unsigned int y, unsigned int z, glm::vec3 &position) {
+  unsigned int cubeindex = this->getCubeIndex(x, y, z);
+  if (this->edgeTable[cubeindex] == 0) {
+    return false;
+  }
+
+  // The vertex is the center of the points where the surface crosses the cube edges
+  glm::vec3 sum(0.0f);
+  unsigned int count = 0;
+
+  for (unsigned int e = 0; e < 12; e++) {
+    if ((this->edgeTable[cubeindex] & (1 << e)) == 0) {
+      continue;
+    }
+
+    unsigned int from = VoxelGrid::edgeCorners[e][0];
+    unsigned int to = VoxelGrid::edgeCorners[e][1];
+
+    sum += this->intLinear(
+      this->getVoxelVertex(x, y, z, from),
+      this->getVoxelVertex(x, y, z, to),
+      this->getIntValue(x, y, z, from),
+      this->getIntValue(x, y, z, to)
+    );
+    count++;
+  }
+
+  position = sum / (float) count;
+
+  return true;
+};
+
+static void addNetTriangle(VoxelPtr voxel, glm::vec3* positions, uint64_t* keys, unsigned int i0, unsigned int i1, unsigned int i2) {
+  VoxelFaceTriangle triangle;
+
+  triangle.a.position = positions[i0];
+  triangle.b.position = positions[i1];
+  triangle.c.position = positions[i2];
+
+  triangle.a.edge = keys[i0];
+  triangle.b.edge = keys[i1];
+  triangle.c.edge = keys[i2];
+
+  // The same normal rule as the marching cubes triangles
+  glm::vec3 n = glm::cross(triangle.a.position - triangle.b.position, triangle.c.position - triangle.b.position);
+  if (glm::length(n) == 0.0f) {
+    n = glm::vec3(0.0f, 1.0f, 0.0f);
+  }
+
+  triangle.normal = glm::normalize(n);
+  triangle.a.normal = triangle.normal;
+  triangle.b.normal = triangle.normal;
+  triangle.c.normal = triangle.normal;
+
+  voxel->resultTriangles.push_back(triangle);
+};
+
+void VoxelGrid::getNetFaces(unsigned int x, unsigned int y, unsigned int z) {
+  bool inside = this->has(x, y, z);
+
+  // Each cube owns the 3 lattice edges going from its first corner, a crossed edge gives a quad of the 4 cubes around it
+  for (unsigned int axis = 0; axis < 3; axis++) {
+    glm::ivec3 along(0);
+    along[axis] = 1;
+
+    if (this->has(x + along.x, y + along.y, z + along.z) == inside) {
+      continue;
+    }
+
+    glm::ivec3 u(0);
+    glm::ivec3 v(0);
+    u[(axis + 1) % 3] = 1;
+    v[(axis + 2) % 3] = 1;
+
+    glm::ivec3 cell(x, y, z);
+    glm::ivec3 cubes[4] = { cell, cell - u, cell - u - v, cell - v };
+
+    glm::vec3 positions[4];
+    uint64_t keys[4];
+    bool complete = true;
+
+    for (unsigned int i = 0; i < 4 && complete; i++) {
+      // Cubes out of the grid have no vertex, marching cubes leaves the same border open
+      complete = cubes[i].x >= 0 && cubes[i].y >= 0 && cubes[i].z >= 0 &&
+        this->getNetVertex(cubes[i].x, cubes[i].y, cubes[i].z, positions[i]);
+      keys[i] = this->getCellKey(cubes[i].x, cubes[i].y, cubes[i].z);
+    }
+
+    if (!complete) {
+      continue;
+    }
+
+    VoxelPtr voxel = this->touch(x, y, z);
+
+    // The quad faces the empty side, the shorter diagonal splits it
+    bool flip = inside;
+    bool shortDiagonal = glm::distance(positions[0], positions[2]) <= glm::distance(positions[1], positions[3]);
+
+    if (shortDiagonal) {
+      addNetTriangle(voxel, positions, keys, 0, flip ? 2 : 1, flip ? 1 : 2);
+      addNetTriangle(voxel, positions, keys, 0, flip ? 3 : 2, flip ? 2 : 3);
+    } else {
+      addNetTriangle(voxel, positions, keys, 1, flip ? 3 : 2, flip ? 2 : 3);
+      addNetTriangle(voxel, positions, keys, 1, flip ? 0 : 3, flip ? 3 : 0);
+    }
+  }
+};
+
+std::vector<VoxelFaceTriangle> VoxelGrid::getVertices(unsigned int x, unsigned int y, unsigned int z) {
+  std::vector<VoxelFaceTriangle> result;
+
+  /*
+   * Determine the index into the edge table which
+   * tells us which vertices are inside of the surface
+   */
+  unsigned int cubeindex = this->getCubeIndex(x, y, z);
+
   /* Cube is entirely in/out of the surface */
   if (this->edgeTable[cubeindex] == 0) {
     return result;
@@ -663,45 +817,50 @@ std::vector<VoxelFaceTriangle> VoxelGrid::getVertices(unsigned int x, unsigned i
     vertices[i] = glm::vec3(0.0f);
   }
 
-  VoxelPtr voxel = this->get(x, y, z);
-  glm::ivec3 voxelPos(x, y, z);
+  // Empty cells next to the occupied ones get triangles too
+  VoxelPtr voxel = this->touch(x, y, z);
+
+  glm::vec3 voxelVertices[8];
+  for (unsigned int i = 0; i < 8; i++) {
+    voxelVertices[i] = this->getVoxelVertex(x, y, z, i);
+  }
 
   /* Find the vertices where the surface intersects the cube */
   if (this->edgeTable[cubeindex] & 1) {
-    vertices[0] = this->intLinear(voxel->voxelVertices[0], voxel->voxelVertices[1], this->getIntValue(x, y, z, 0), this->getIntValue(x, y, z, 1));
+    vertices[0] = this->intLinear(voxelVertices[0], voxelVertices[1], this->getIntValue(x, y, z, 0), this->getIntValue(x, y, z, 1));
   }
   if (this->edgeTable[cubeindex] & 2) {
-    vertices[1] = this->intLinear(voxel->voxelVertices[1], voxel->voxelVertices[2], this->getIntValue(x, y, z, 1), this->getIntValue(x, y, z, 2));
+    vertices[1] = this->intLinear(voxelVertices[1], voxelVertices[2], this->getIntValue(x, y, z, 1), this->getIntValue(x, y, z, 2));
   }
   if (this->edgeTable[cubeindex] & 4) {
-    vertices[2] = this->intLinear(voxel->voxelVertices[2], voxel->voxelVertices[3], this->getIntValue(x, y, z, 2), this->getIntValue(x, y, z, 3));
+    vertices[2] = this->intLinear(voxelVertices[2], voxelVertices[3], this->getIntValue(x, y, z, 2), this->getIntValue(x, y, z, 3));
   }
   if (this->edgeTable[cubeindex] & 8) {
-    vertices[3] = this->intLinear(voxel->voxelVertices[3], voxel->voxelVertices[0], this->getIntValue(x, y, z, 3), this->getIntValue(x, y, z, 0));
+    vertices[3] = this->intLinear(voxelVertices[3], voxelVertices[0], this->getIntValue(x, y, z, 3), this->getIntValue(x, y, z, 0));
   }
   if (this->edgeTable[cubeindex] & 16) {
-    vertices[4] = this->intLinear(voxel->voxelVertices[4], voxel->voxelVertices[5], this->getIntValue(x, y, z, 4), this->getIntValue(x, y, z, 5));
+    vertices[4] = this->intLinear(voxelVertices[4], voxelVertices[5], this->getIntValue(x, y, z, 4), this->getIntValue(x, y, z, 5));
   }
   if (this->edgeTable[cubeindex] & 32) {
-    vertices[5] = this->intLinear(voxel->voxelVertices[5], voxel->voxelVertices[6], this->getIntValue(x, y, z, 5), this->getIntValue(x, y, z, 6));
+    vertices[5] = this->intLinear(voxelVertices[5], voxelVertices[6], this->getIntValue(x, y, z, 5), this->getIntValue(x, y, z, 6));
   }
   if (this->edgeTable[cubeindex] & 64) {
-    vertices[6] = this->intLinear(voxel->voxelVertices[6], voxel->voxelVertices[7], this->getIntValue(x, y, z, 6), this->getIntValue(x, y, z, 7));
+    vertices[6] = this->intLinear(voxelVertices[6], voxelVertices[7], this->getIntValue(x, y, z, 6), this->getIntValue(x, y, z, 7));
   }
   if (this->edgeTable[cubeindex] & 128) {
-    vertices[7] = this->intLinear(voxel->voxelVertices[7], voxel->voxelVertices[4], this->getIntValue(x, y, z, 7), this->getIntValue(x, y, z, 4));
+    vertices[7] = this->intLinear(voxelVertices[7], voxelVertices[4], this->getIntValue(x, y, z, 7), this->getIntValue(x, y, z, 4));
   }
   if (this->edgeTable[cubeindex] & 256) {
-    vertices[8] = this->intLinear(voxel->voxelVertices[0], voxel->voxelVertices[4], this->getIntValue(x, y, z, 0), this->getIntValue(x, y, z, 4));
+    vertices[8] = this->intLinear(voxelVertices[0], voxelVertices[4], this->getIntValue(x, y, z, 0), this->getIntValue(x, y, z, 4));
   }
   if (this->edgeTable[cubeindex] & 512) {
-    vertices[9] = this->intLinear(voxel->voxelVertices[1], voxel->voxelVertices[5], this->getIntValue(x, y, z, 1), this->getIntValue(x, y, z, 5));
+    vertices[9] = this->intLinear(voxelVertices[1], voxelVertices[5], this->getIntValue(x, y, z, 1), this->getIntValue(x, y, z, 5));
   }
   if (this->edgeTable[cubeindex] & 1024) {
-    vertices[10] = this->intLinear(voxel->voxelVertices[2], voxel->voxelVertices[6], this->getIntValue(x, y, z, 2), this->getIntValue(x, y, z, 6));
+    vertices[10] = this->intLinear(voxelVertices[2], voxelVertices[6], this->getIntValue(x, y, z, 2), this->getIntValue(x, y, z, 6));
   }
   if (this->edgeTable[cubeindex] & 2048) {
-    vertices[11] = this->intLinear(voxel->voxelVertices[3], voxel->voxelVertices[7], this->getIntValue(x, y, z, 3), this->getIntValue(x, y, z, 7));
+    vertices[11] = this->intLinear(voxelVertices[3], voxelVertices[7], this->getIntValue(x, y, z, 3), this->getIntValue(x, y, z, 7));
   }
 
   /* Create the triangle */
@@ -713,6 +872,10 @@ std::vector<VoxelFaceTriangle> VoxelGrid::getVertices(unsigned int x, unsigned i
     glm::vec3 b = vertices[this->triTable[cubeindex][i + 1]];
     glm::vec3 c = vertices[this->triTable[cubeindex][i + 2]];
 
+    triangle.a.edge = this->getEdgeKey(x, y, z, this->triTable[cubeindex][i    ]);
+    triangle.b.edge = this->getEdgeKey(x, y, z, this->triTable[cubeindex][i + 1]);
+    triangle.c.edge = this->getEdgeKey(x, y, z, this->triTable[cubeindex][i + 2]);
+
     glm::vec3 n = glm::cross(a - b, c - b);
     float length = glm::length(n);
 
@@ -773,55 +936,108 @@ bool VoxelGrid::pointInCell(glm::vec3 p, glm::ivec3 cell) {
 };
 
 bool VoxelGrid::triangleIntersectsCell(glm::vec3 a, glm::vec3 b, glm::vec3 c, glm::ivec3 cell) {
-  //glm::vec3 cellCenter = (glm::vec3(cell.x, cell.y, cell.z) * this->units) + (this->units * 0.5f);
-  glm::ivec3 xp = this->vecToGrid(a.x, a.y, a.z);
-  glm::ivec3 yp = this->vecToGrid(b.x, b.y, b.z);
-  glm::ivec3 zp = this->vecToGrid(c.x, c.y, c.z);
+  glm::vec3 halfSize = this->units * 0.5f;
+  glm::vec3 boxCenter = this->gridToVec(cell.x, cell.y, cell.z) + halfSize;
+
+  return TriangleBox::test(boxCenter, halfSize, a, b, c);
+};
+
+static void flushCells(TriangleBoxSimd::Triangle &triangle, TriangleBoxSimd::CellBatch &batch, std::vector<glm::ivec3> &cells) {
+  unsigned int mask = TriangleBoxSimd::test(triangle, batch);
 
-  glm::ivec3 minValues(999, 999, 999);
-  glm::ivec3 maxValues(0, 0, 0);
+  for (unsigned int i = 0; i < batch.size; i++) {
+    if (mask & (1u << i)) {
+      cells.push_back(batch.cells[i]);
+    }
+  }
 
-  minValues.x = std::min(xp.x, std::min(yp.x, zp.x));
-  minValues.y = std::min(xp.y, std::min(yp.y, zp.y));
-  minValues.z = std::min(xp.z, std::min(yp.z, zp.z));
+  batch.size = 0;
+};
 
-  maxValues.x = std::max(xp.x, std::max(yp.x, zp.x));
-  maxValues.y = std::max(xp.y, std::max(yp.y, zp.y));
-  maxValues.z = std::max(xp.z, std::max(yp.z, zp.z));
+void VoxelGrid::overlappingCells(glm::vec3 ga, glm::vec3 gb, glm::vec3 gc, std::vector<glm::ivec3> &cells) {
+  // Tolerance in cell units, a triangle lying on a cell face belongs to both cells
+  const float epsilon = 1e-4f;
 
-  glm::vec3 boxCenter(0.0f, 0.0f, 0.0f);
-  glm::vec3 halfSize = this->units * 0.5f;
+  cells.clear();
+
+  glm::ivec3 last = this->gridResolution - glm::ivec3(1);
+  // In grid space the cells are unit cubes with the centers at i + 0.5
+  glm::ivec3 minCell = glm::clamp(GridMath::fastFloor(glm::min(ga, glm::min(gb, gc))), glm::ivec3(0), last);
+  glm::ivec3 maxCell = glm::clamp(GridMath::fastFloor(glm::max(ga, glm::max(gb, gc))), glm::ivec3(0), last);
+
+  TriangleBoxSimd::Triangle triangle;
+  TriangleBoxSimd::prepare(triangle, ga, gb, gc, glm::vec3(0.5f + epsilon));
+
+  // Only the cells of the slab around the triangle plane are tested, walking along the dominant normal axis
+  glm::vec3 normal = glm::cross(gb - ga, gc - gb);
+  glm::vec3 absNormal = glm::abs(normal);
+
+  int k = 0;
+  if (absNormal.y > absNormal[k]) k = 1;
+  if (absNormal.z > absNormal[k]) k = 2;
+  int i = (k + 1) % 3;
+  int j = (k + 2) % 3;
+
+  float planeDistance = glm::dot(normal, ga);
+  float planeRadius = (0.5f + epsilon) * (absNormal.x + absNormal.y + absNormal.z);
 
-  for (unsigned int dx = minValues.x; dx <= maxValues.x; dx++) {
-    for (unsigned int dy = minValues.y; dy <= maxValues.y; dy++) {
-      for (unsigned int dz = minValues.z; dz <= maxValues.z; dz++) {
-        boxCenter = this->gridToVec(dx, dy, dz) + (this->units * 0.5f);
+  TriangleBoxSimd::CellBatch batch;
+  glm::ivec3 cell;
 
-        if (TriangleBox::test(boxCenter, halfSize, a, b, c)) {
-          return true;
+  for (int ci = minCell[i]; ci <= maxCell[i]; ci++) {
+    for (int cj = minCell[j]; cj <= maxCell[j]; cj++) {
+      int from = minCell[k];
+      int to = maxCell[k];
+
+      if (normal[k] != 0.0f) {
+        float rest = normal[i] * ((float) ci + 0.5f) + normal[j] * ((float) cj + 0.5f);
+        float t1 = (planeDistance - rest - planeRadius) / normal[k];
+        float t2 = (planeDistance - rest + planeRadius) / normal[k];
+
+        from = std::max(from, (int) std::ceil(std::min(t1, t2) - 0.5f));
+        to = std::min(to, (int) std::floor(std::max(t1, t2) - 0.5f));
+      }
+
+      for (int ck = from; ck <= to; ck++) {
+        cell[i] = ci;
+        cell[j] = cj;
+        cell[k] = ck;
+
+        batch.x[batch.size] = (float) cell.x + 0.5f;
+        batch.y[batch.size] = (float) cell.y + 0.5f;
+        batch.z[batch.size] = (float) cell.z + 0.5f;
+        batch.cells[batch.size] = cell;
+        batch.size++;
+
+        if (batch.size == TriangleBoxSimd::Width) {
+          flushCells(triangle, batch, cells);
         }
       }
     }
   }
 
-  // if (this->pointInCell(a, cell)) {
-  //   return true;
-  // }
+  if (batch.size > 0) {
+    flushCells(triangle, batch, cells);
+  }
+};
 
-  // if (this->pointInCell(b, cell)) {
-  //   return true;
-  // }
+void VoxelGrid::addFaces(MeshObject &mesh, unsigned int material) {
+  // All corners go to grid space in one batch, voxelization then never divides
+  std::vector<glm::vec3> corners(mesh->faces.size() * 3);
+  for (size_t f = 0; f < mesh->faces.size(); f++) {
+    for (unsigned int i = 0; i < 3; i++) {
+      corners[f * 3 + i] = mesh->position[mesh->faces[f].positionIndices[i]];
+    }
+  }
 
-  // if (this->pointInCell(c, cell)) {
-  //   return true;
-  // }
+  this->toGridSpace(corners.data(), corners.data(), corners.size());
 
-  return false;
-};
+  size_t index = 0;
+  this->sourceFaces.reserve(this->sourceFaces.size() + mesh->faces.size());
 
-void VoxelGrid::voxelize(MeshObject &mesh) {
   for (Face &face : mesh->faces) {
-    VoxelFacePtr voxelFace = std::make_shared<VoxelFace>();
+    this->sourceFaces.emplace_back();
+    VoxelFace* voxelFace = &this->sourceFaces.back();
     for (unsigned int i = 0; i < 3; i++) {
       VoxelFaceVertex voxelFaceVertex;
 
@@ -838,63 +1054,124 @@ void VoxelGrid::voxelize(MeshObject &mesh) {
       }
 
       voxelFace->vertices[i] = voxelFaceVertex;
+      voxelFace->grid[i] = corners[index++];
     }
 
-    voxelFace->materialName = mesh->material->name;
+    voxelFace->material = material;
 
     glm::vec3 a = voxelFace->vertices[0].normal;
     glm::vec3 b = voxelFace->vertices[1].normal;
     glm::vec3 c = voxelFace->vertices[2].normal;
 
-    glm::vec3 normal = glm::normalize(glm::cross(c - a, b - a));
+    voxelFace->normal = glm::normalize(glm::cross(c - a, b - a));
 
+    float minZ = std::min(voxelFace->grid[0].z, std::min(voxelFace->grid[1].z, voxelFace->grid[2].z));
+    float maxZ = std::max(voxelFace->grid[0].z, std::max(voxelFace->grid[1].z, voxelFace->grid[2].z));
 
-    /** Get Min/Max cells of the target triangle */
-    glm::ivec3 minGridCell(999, 999, 999);
-    glm::ivec3 maxGridCell(-999, -999, -999);
+    // A layer of margin, overlappingCells takes the touching cells too
+    voxelFace->minZ = GridMath::fastFloor(minZ) - 1;
+    voxelFace->maxZ = GridMath::fastFloor(maxZ) + 1;
+  }
+};
 
-    glm::ivec3 cellA = this->vecToGrid(voxelFace->vertices[0].position.x, voxelFace->vertices[0].position.y, voxelFace->vertices[0].position.z);
-    glm::ivec3 cellB = this->vecToGrid(voxelFace->vertices[1].position.x, voxelFace->vertices[1].position.y, voxelFace->vertices[1].position.z);
-    glm::ivec3 cellC = this->vecToGrid(voxelFace->vertices[2].position.x, voxelFace->vertices[2].position.y, voxelFace->vertices[2].position.z);
+void VoxelGrid::voxelize(const std::vector<VoxelFace> &faces) {
+  std::vector<glm::ivec3> cells;
 
-    minGridCell.x = std::min(std::min(cellA.x, cellB.x), cellC.x);
-    minGridCell.y = std::min(std::min(cellA.y, cellB.y), cellC.y);
-    minGridCell.z = std::min(std::min(cellA.z, cellB.z), cellC.z);
+  for (unsigned int f = 0; f < faces.size(); f++) {
+    const VoxelFace* voxelFace = &faces[f];
 
-    maxGridCell.x = std::max(std::max(cellA.x, cellB.x), cellC.x);
-    maxGridCell.y = std::max(std::max(cellA.y, cellB.y), cellC.y);
-    maxGridCell.z = std::max(std::max(cellA.z, cellB.z), cellC.z);
+    // The face belongs to the other slabs
+    if (voxelFace->maxZ < this->slabBegin - 1 || voxelFace->minZ > this->slabEnd) {
+      continue;
+    }
 
     // Add face to all cells that intersects with it
-    for (int dx = minGridCell.x; dx <= maxGridCell.x; dx++) {
-      for (int dy = minGridCell.y; dy <= maxGridCell.y; dy++) { 
-        for (int dz = minGridCell.z; dz <= maxGridCell.z; dz++) {
-          bool intersects = this->triangleIntersectsCell(
-            voxelFace->vertices[0].position,
-            voxelFace->vertices[1].position,
-            voxelFace->vertices[2].position,
-            glm::ivec3(dx, dy, dz)
-          );
-
-          if (intersects) {
-            VoxelPtr ptr = this->get(dx, dy, dz);
-
-            if (ptr->faces.size() == 0) {
-              ptr->averageNormal = normal;
-            } else {
-              ptr->averageNormal += normal;
-              ptr->averageNormal = glm::normalize(ptr->averageNormal * 0.5f);
-            }
-            
-            ptr->faces.push_back(voxelFace);
-          }
-        }
+    this->overlappingCells(voxelFace->grid[0], voxelFace->grid[1], voxelFace->grid[2], cells);
+
+    for (glm::ivec3 &cell : cells) {
+      if (cell.z < this->slabBegin - 1 || cell.z > this->slabEnd) {
+        continue;
+      }
+
+      VoxelPtr ptr = this->touch(cell.x, cell.y, cell.z);
+
+      if (ptr->faces.size() == 0) {
+        ptr->averageNormal = voxelFace->normal;
+      } else {
+        ptr->averageNormal += voxelFace->normal;
+        ptr->averageNormal = glm::normalize(ptr->averageNormal * 0.5f);
       }
+      
+      ptr->faces.push_back(f);
+      ptr->occupied = true;
     }
   }
 };
 
-void VoxelGrid::rasterize(GroupObject &src, GroupObject &dest) {
+void VoxelGrid::fill(std::vector<glm::ivec3> &cells, std::vector<glm::vec3> &normals) {
+  for (size_t i = 0; i < cells.size(); i++) {
+    glm::ivec3 &cell = cells[i];
+
+    if (cell.z < this->slabBegin - 1 || cell.z > this->slabEnd) {
+      continue;
+    }
+
+    VoxelPtr ptr = this->touch(cell.x, cell.y, cell.z);
+    ptr->averageNormal = normals[i];
+    ptr->occupied = true;
+  }
+};
+
+void VoxelGrid::polygonize() {
+  this->collectActiveCells();
+
+  for (glm::ivec3 &cell : this->activeCells) {
+    if (this->mesher == VoxelMesher::SurfaceNets) {
+      this->getNetFaces(cell.x, cell.y, cell.z);
+    } else {
+      this->getVertices(cell.x, cell.y, cell.z);
+    }
+  }
+};
+
+VoxelGrid* VoxelGrid::slab(unsigned int index) {
+  return (index == 0) ? this : this->slabGrids[index - 1].get();
+};
+
+void VoxelGrid::prepareSlabs(float depth) {
+  Scheduler &scheduler = Scheduler::GetInstance();
+
+  // Only the layers the model spans are split, a grid is cubic and a flat model leaves the rest empty
+  int used = std::max(1, std::min(this->gridResolution.z, (int) std::ceil(depth / this->units.z) + 1));
+
+  // Slabs are whole bricks and not too thin, the faces crossing a border are voxelized by both slabs
+  unsigned int layers = std::max(1, used / VOXEL_SLAB_MIN);
+  this->slabCount = std::max(1u, std::min(layers, scheduler.classThreads(TaskClass::Voxelize)));
+
+  int thickness = (used + this->slabCount - 1) / this->slabCount;
+  thickness = ((thickness + VOXEL_BRICK_SIZE - 1) / VOXEL_BRICK_SIZE) * VOXEL_BRICK_SIZE;
+
+  while (this->slabGrids.size() + 1 < this->slabCount) {
+    GridRef grid = std::make_shared<VoxelGrid>();
+    grid->gridResolution = this->gridResolution;
+    grid->init();
+
+    this->slabGrids.push_back(grid);
+  }
+
+  for (unsigned int i = 0; i < this->slabCount; i++) {
+    VoxelGrid* grid = this->slab(i);
+
+    grid->setSpace(this->gridOffset, this->units);
+    grid->isoLevel = this->isoLevel;
+    grid->mesher = this->mesher;
+
+    grid->slabBegin = std::min(this->gridResolution.z, (int) i * thickness);
+    grid->slabEnd = (i + 1 == this->slabCount) ? this->gridResolution.z : std::min(this->gridResolution.z, (int) (i + 1) * thickness);
+  }
+};
+
+unsigned int VoxelGrid::rasterize(GroupObject &src, GroupObject &dest) {
   // std::cout << "Init grid" << std::endl;
   // std::cout << "Rasterize has been started" << std::endl;
   src->computeBoundingBox();
@@ -910,305 +1187,359 @@ void VoxelGrid::rasterize(GroupObject &src, GroupObject &dest) {
     )
   );
 
-  this->gridOffset = glm::vec3(dimensionsBox.min.x, dimensionsBox.min.y, dimensionsBox.min.z);
-  this->units = glm::vec3(maxUnit, maxUnit, maxUnit);// Temporary (probably)
+  this->setSpace(glm::vec3(dimensionsBox.min.x, dimensionsBox.min.y, dimensionsBox.min.z), glm::vec3(maxUnit, maxUnit, maxUnit));// Temporary (probably)
   //this->init();
 
+  std::vector<glm::ivec3> octreeCells;
+  std::vector<glm::vec3> octreeNormals;
+
+  if (this->octree != nullptr) {
+    // The grid is aligned to the octree level that fits the box, so the cells are taken as they are
+    glm::ivec3 minCell;
+    glm::ivec3 maxCell;
+    unsigned int level = this->octree->fit(dimensionsBox, this->gridResolution, minCell, maxCell);
+    float cellSize = this->octree->cellSize(level);
+
+    this->setSpace(this->octree->origin + glm::vec3(minCell) * cellSize, glm::vec3(cellSize));
+
+    this->octree->collect(level, minCell, maxCell, octreeCells, octreeNormals);
+  }
+
   this->clear();
+  this->prepareSlabs(dimensionsBox.max.z - this->gridOffset.z);
+
+  // Every source mesh goes into the same grid, a face remembers the index of its mesh as the material id
+  std::vector<MeshObject> meshes;
 
-  std::map<std::string, MeshObject> materialMeshMap;
+  this->sourceBVH.clear();
+  this->sourceMaterials.clear();
 
-  // unsigned int meshIndex = 0;
   src->traverse([&](MeshObject target){
-    // std::cout << "Voxelize has been started" << std::endl;
-    this->voxelize(target);
-    // std::cout << "Voxelize has been finished" << std::endl;
+    unsigned int material = meshes.size();
+    if (this->octree == nullptr) {
+      this->addFaces(target, material);
+    }
+
+    if (this->materialBVH.size() <= material) {
+      this->materialBVH.resize(material + 1);
+      this->materialUVs.resize(material + 1);
+      this->materialTexelSize.resize(material + 1);
+    }
+
+    this->materialBVH[material].clear();
+    this->materialUVs[material].clear();
+
+    double surfaceArea = 0.0;
+    double textureArea = 0.0;
+
+    for (Face &face : target->faces) {
+      glm::vec3 a = target->position[face.positionIndices[0]];
+      glm::vec3 b = target->position[face.positionIndices[1]];
+      glm::vec3 c = target->position[face.positionIndices[2]];
+
+      this->sourceBVH.add(a, b, c);
+      this->sourceMaterials.push_back(material);
+
+      this->materialBVH[material].add(a, b, c);
+      for (unsigned int i = 0; i < 3; i++) {
+        this->materialUVs[material].push_back(target->hasUVs ? target->uv[face.uvIndices[i]] : glm::vec2(0.0f));
+      }
+
+      if (target->hasUVs) {
+        glm::vec2 *uv = &this->materialUVs[material][this->materialUVs[material].size() - 3];
+        glm::vec2 du = uv[1] - uv[0];
+        glm::vec2 dv = uv[2] - uv[0];
+
+        surfaceArea += 0.5 * glm::length(glm::cross(b - a, c - a));
+        textureArea += 0.5 * std::abs(du.x * dv.y - du.y * dv.x);
+      }
+    }
+
+    // Baked atlases are never finer than the source texture
+    Image &image = target->material->diffuseMapImage;
+    this->materialTexelSize[material] = 0.0f;
+    if (image.data != NULL && textureArea > 0.0) {
+      this->materialTexelSize[material] = (float) std::sqrt(surfaceArea / (textureArea * image.width * image.height));
+    }
 
     MeshObject mesh = MeshObject(new Mesh());
-    // mesh->name = std::string("Voxels_") + target->name + std::string("_") + std::to_string(meshIndex);
-    // mesh->material.name = "VoxelMeshMaterial";
-    // mesh->material.color.set(0.5f, 0.5f, 0.5f);
 
     mesh->name = target->name;
-    //mesh->material = target->material;//->clone(true);
     mesh->material = target->material;//->clone(true);
-    //mesh->material->diffuseMapImage = target->material->diffuseMapImage;
-
-    // mesh->material->name = target->material.name;
-    // mesh->material->color.set(0.5f, 1.0f, 0.0f);
 
     mesh->hasNormals = target->hasNormals;
     mesh->hasUVs = target->hasUVs;
 
-    if (materialMeshMap.count(mesh->material->name) == 0) {
-      materialMeshMap[mesh->material->name] = mesh;
-    }
+    meshes.push_back(mesh);
+  });
 
-    // std::cout << "Rasterize" << std::endl;
-    for (unsigned int x = 0; x < (unsigned int) this->gridResolution.x; x++) {
-      for (unsigned int y = 0; y < (unsigned int) this->gridResolution.y; y++) {
-        for (unsigned int z = 0; z < (unsigned int) this->gridResolution.z; z++) {
-          this->getVertices(x, y, z);
-        }
-      }
-    }
+  // One marching cubes pass over the shared occupancy, every z-slab is voxelized and polygonized on its own thread.
+  // Vertices are keyed by the global grid edge, so the slab borders are stitched by build() whatever the slab count is
+  Scheduler::GetInstance().parallel(TaskClass::Voxelize, this->slabCount, 1, [&](size_t begin, size_t end) {
+    for (size_t i = begin; i < end; i++) {
+      VoxelGrid* grid = this->slab(i);
 
-    float geometricError = 0.0f;
-    unsigned int voxelsUsed = 0;
-
-    for (unsigned int x = 0; x < (unsigned int) this->gridResolution.x; x++) {
-      for (unsigned int y = 0; y < (unsigned int) this->gridResolution.y; y++) {
-        for (unsigned int z = 0; z < (unsigned int) this->gridResolution.z; z++) {
-          VoxelPtr voxel = this->get(x, y, z);
-          voxel->computeError();
-          geometricError += voxel->geometricError;
-          if (voxel->geometricError != 0.0f) {
-            voxelsUsed++;
-          }
-
-          glm::ivec3 voxelPos(x, y, z);
-
-          for (VoxelFaceTriangle &triangle : voxel->resultTriangles) {
-            this->getClosestUV(triangle, voxelPos);
-            /*
-            triangle.a.uv = Vector2f::fromGLM(this->getClosestUV(voxelPos, triangle.a.position.toGLM()));
-            triangle.b.uv = Vector2f::fromGLM(this->getClosestUV(voxelPos, triangle.b.position.toGLM()));
-            triangle.c.uv = Vector2f::fromGLM(this->getClosestUV(voxelPos, triangle.c.position.toGLM()));
-            */
-          }
-        }
+      if (this->octree != nullptr) {
+        grid->fill(octreeCells, octreeNormals);
+      } else {
+        grid->voxelize(this->sourceFaces);
       }
+
+      grid->polygonize();
     }
+  });
 
-    if (voxelsUsed > 0) {
-      geometricError /= (float) voxelsUsed;
+  this->sourceBVH.build();
+  for (unsigned int i = 0; i < meshes.size(); i++) {
+    this->materialBVH[i].build();
+  }
+
+  this->assignMaterials();
+  this->build(meshes);
+  this->transferUVs(meshes);
+  this->computeError(meshes);
+
+  for (MeshObject &mesh : meshes) {
+    if (mesh->faces.size() == 0) {
+      continue;
     }
 
-    // std::cout << "Finish mesh" << std::endl;
-    this->build(mesh, materialMeshMap);
     mesh->computeUVBox();
     mesh->computeBoundingBox();
     mesh->finish();
 
-    // MeshObject simplified = simplifier::modify(mesh, 0.1f);
+    // The mesh is indexed, the vertices are shared through the grid edges
+    mesh->geometricError = this->hausdorffError;
 
-    mesh->triangulate();
-    mesh->geometricError = geometricError;
-    
     dest->meshes.push_back(mesh);
-    // meshIndex++;
-    this->clear();
-    // mesh->free(false);
-  });
+  }
 
-  // std::cout << "Rasterize has been finished" << std::endl;
+  for (unsigned int i = 0; i < this->slabCount; i++) {
+    this->slab(i)->clear();
+  }
 
-  // dest->computeGeometricError();
+  this->sourceFaces.clear();
+  if (this->bake) {
+    this->passMeshes = meshes;
+  }
 
-  /*
-  this->build(dest->meshes[0], materialMeshMap);
-  dest->meshes[0]->finish();
-  */
+  return meshes.size();
+};
 
-  // dest->traverse([&](MeshObject target){
-  //   this->build(target, materialMeshMap);
-  //   target->finish();
-  // });
+void VoxelGrid::collectTriangles(std::vector<VoxelFaceTriangle*> &triangles) {
+  triangles.clear();
 
-  //this->clear();
-};
+  // Slabs go in z order and their cells in z, y, x order, the same order a single grid gives
+  for (unsigned int s = 0; s < this->slabCount; s++) {
+    VoxelGrid* grid = this->slab(s);
 
-void VoxelGrid::build(VoxelFaceTriangle &triangle, VoxelFaceVertex &vertex, std::vector<LinkedPosition> &list, unsigned int x, unsigned int y, unsigned int z) {
-  VoxelFaceVertex resultVertex;
-  resultVertex.position = vertex.position;
-  resultVertex.normal = vertex.normal;
-  resultVertex.uv = vertex.uv;
-
-  int index = list.size();
-  resultVertex.index = index;
-  vertex.index = index;
-
-  LinkedPosition linked;
-  linked.linkedTriangles.push_back(triangle);
-  linked.vertex = resultVertex;
-
-  // Look for the same vertex in adjacent cells
-  for (int i = -1; i <= 1; i++) {
-    for (int k = -1; k <= 1; k++) {
-      for (int m = -1; m <= 1; m++) {
-        if (this->hasTriangles(x + i, y + k, z + m)) {
-          VoxelPtr voxel = this->get(x + i, y + k, z + m);
-
-          // Go for each triangle in target
-          for (VoxelFaceTriangle &vTriangle : voxel->resultTriangles) {// Access by ref to modify origin
-            // Go for each position and compare
-            bool exists = false;
-
-            // if (vTriangle.a.index == -1) {// Not calculated vertex A
-              if (glm::all(glm::equal(vertex.position, vTriangle.a.position)) && false) {
-                vTriangle.a.index = index;
-                exists = true;
-              }
-            // } else {
-            //   // std::cout << "Vertex already assigned: (" << i << ", " << k << ", " << m << ")" << std::endl;
-            // }
-            
-            // if (vTriangle.b.index == -1) {// Not calculated vertex B
-              if (glm::all(glm::equal(vertex.position, vTriangle.b.position)) && false) {
-                vTriangle.b.index = index;
-                exists = true;  
-              }
-            // } else {
-            //   // std::cout << "Vertex already assigned: (" << i << ", " << k << ", " << m << ")" << std::endl;
-            // }
-
-            //if (vTriangle.c.index == -1) {// Not calculated vertex C
-              if (glm::all(glm::equal(vertex.position, vTriangle.c.position)) && false) {
-                vTriangle.c.index = index;
-                exists = true;
-              }
-            // } else {
-            //  // std::cout << "Vertex already assigned: (" << i << ", " << k << ", " << m << ")" << std::endl;
-            // }
-
-            if (exists) {
-              linked.linkedTriangles.push_back(vTriangle);
-            }
-          }
+    for (glm::ivec3 &cell : grid->activeCells) {
+      VoxelPtr target = grid->get(cell.x, cell.y, cell.z);
+      if (target == nullptr) {
+        continue;
+      }
 
-        }
+      for (VoxelFaceTriangle &triangle : target->resultTriangles) {
+        triangles.push_back(&triangle);
       }
     }
   }
-
-  list.push_back(linked);
 };
 
-void VoxelGrid::build(MeshObject &mesh, std::map<std::string, MeshObject> &materialMeshMap) {
-  std::vector<LinkedPosition> linkedList;
-  std::vector<VoxelFaceTriangle> triangles;
-
-  for (unsigned int x = 0; x < (unsigned int) this->gridResolution.x; x++) {
-    for (unsigned int y = 0; y < (unsigned int) this->gridResolution.y; y++) {
-      for (unsigned int z = 0; z < (unsigned int) this->gridResolution.z; z++) {
-        VoxelPtr target = this->get(x, y, z);
-        // Go for each triangle in target
-        for (VoxelFaceTriangle &triangle : target->resultTriangles) {// Access by ref to modify origin
-          // Go for each position, build and save into linked list
-          if (triangle.a.index == -1) {// Not calculated
-            this->build(triangle, triangle.a, linkedList, x, y, z);
-          }
-          
-          if (triangle.b.index == -1) {// Not calculated
-            this->build(triangle, triangle.b, linkedList, x, y, z);
-          }
-
-          if (triangle.c.index == -1) {// Not calculated
-            this->build(triangle, triangle.c, linkedList, x, y, z);
-          }
-        }
-      }
+void VoxelGrid::build(std::vector<MeshObject> &meshes) {
+  std::vector<VoxelFaceTriangle*> triangles;
+  this->collectTriangles(triangles);
+
+  // Normals are averaged over every triangle of the edge, neither UV seams nor material borders break the shading
+  std::unordered_map<uint64_t, glm::vec3> edgeNormals;
+
+  for (VoxelFaceTriangle* triangle : triangles) {
+    for (unsigned int i = 0; i < 3; i++) {
+      edgeNormals[(*triangle)[i].edge] += triangle->normal;
     }
   }
 
-  for (unsigned int x = 0; x < (unsigned int) this->gridResolution.x; x++) {
-    for (unsigned int y = 0; y < (unsigned int) this->gridResolution.y; y++) {
-      for (unsigned int z = 0; z < (unsigned int) this->gridResolution.z; z++) {
-        //if (this->has(x, y, z)) {
-          VoxelPtr target = this->get(x, y, z);
-          // Go for each triangle in target
-          for (VoxelFaceTriangle &triangle : target->resultTriangles) {// Access by ref to modify origin
-            // Go for each position and save into linked list   
-            triangles.push_back(triangle);
-          }
-        //}
+  // A vertex per grid edge and material, its UV is projected from the source of the material later
+  std::vector<std::unordered_map<uint64_t, unsigned int>> edgeVertices(meshes.size());
+
+  for (VoxelFaceTriangle* triangle : triangles) {
+    MeshObject &mesh = meshes[triangle->material];
+    Face face;
+
+    for (unsigned int i = 0; i < 3; i++) {
+      VoxelFaceVertex &vertex = (*triangle)[i];
+
+      std::pair<std::unordered_map<uint64_t, unsigned int>::iterator, bool> inserted = edgeVertices[triangle->material].insert(
+        std::make_pair(vertex.edge, (unsigned int) mesh->position.size())
+      );
+
+      unsigned int index = inserted.first->second;
+
+      if (inserted.second) {
+        // Opposite triangles cancel out, the vertex keeps the normal of its own triangle then
+        glm::vec3 &sum = edgeNormals[vertex.edge];
+
+        mesh->position.push_back(vertex.position);
+        mesh->normal.push_back(glm::length(sum) > 0.0f ? glm::normalize(sum) : vertex.normal);
+        mesh->uv.push_back(glm::vec2(0.0f));
       }
+
+      face.positionIndices[i] = index;
+      face.normalIndices[i] = index;
+      face.uvIndices[i] = index;
     }
+
+    mesh->faces.push_back(face);
   }
-  
-  //MeshObject targetMesh = mesh;//materialMeshMap.begin()->second;
+};
 
-  for (LinkedPosition &linked : linkedList) {
-    mesh->position.push_back(linked.vertex.position);
+void VoxelGrid::assignMaterials() {
+  std::vector<VoxelFaceTriangle*> triangles;
+  this->collectTriangles(triangles);
 
-    if (linked.linkedTriangles.size() > 0 && false) {
-      glm::vec3 normal = glm::vec3(0.0f, 0.0f, 0.0f);
-      
-      for (VoxelFaceTriangle &tr : linked.linkedTriangles) {
-        normal += tr.normal;
-      }
+  // A triangle takes the material of the source surface closest to its center
+  Scheduler::GetInstance().parallel(TaskClass::Voxelize, triangles.size(), 2048, [&](size_t begin, size_t end) {
+    TriangleBVHHit hit;
 
-      normal /= (float) linked.linkedTriangles.size();
-      mesh->normal.push_back(glm::normalize(normal));
-    } else {
-      mesh->normal.push_back(linked.vertex.normal);
+    for (size_t i = begin; i < end; i++) {
+      VoxelFaceTriangle &triangle = *triangles[i];
+      glm::vec3 center = (triangle.a.position + triangle.b.position + triangle.c.position) / 3.0f;
+
+      if (this->sourceBVH.closestPoint(center, hit)) {
+        triangle.material = this->sourceMaterials[hit.triangle];
+      }
     }
-    // mesh->uv.push_back(linked.vertex.uv);
+  });
+};
 
-    //if (mesh->uv.size() > 0) {
-      mesh->uv.push_back(linked.vertex.uv);
-    //}
-  }
+void VoxelGrid::transferUVs(std::vector<MeshObject> &meshes) {
+  for (unsigned int m = 0; m < meshes.size(); m++) {
+    MeshObject &mesh = meshes[m];
+    if (!mesh->hasUVs) {
+      continue;
+    }
 
-  for (VoxelFaceTriangle &triangle : triangles) {
-    Face face;
+    TriangleBVH &bvh = this->materialBVH[m];
+    std::vector<glm::vec2> &uvs = this->materialUVs[m];
 
-    face.positionIndices[0] = (unsigned int) triangle.a.index;
-    face.positionIndices[1] = (unsigned int) triangle.b.index;
-    face.positionIndices[2] = (unsigned int) triangle.c.index;
+    // Every vertex is projected onto the closest source triangle of its material, the UV is interpolated there
+    Scheduler::GetInstance().parallel(TaskClass::Voxelize, mesh->position.size(), 2048, [&](size_t begin, size_t end) {
+      TriangleBVHHit hit;
 
-    face.normalIndices[0] = face.positionIndices[0];
-    face.normalIndices[1] = face.positionIndices[1];
-    face.normalIndices[2] = face.positionIndices[2];
+      for (size_t i = begin; i < end; i++) {
+        if (!bvh.closestPoint(mesh->position[i], hit)) {
+          continue;
+        }
 
-    face.uvIndices[0] = face.positionIndices[0];
-    face.uvIndices[1] = face.positionIndices[1];
-    face.uvIndices[2] = face.positionIndices[2];
+        glm::vec2 &a = uvs[hit.triangle * 3];
+        glm::vec2 &b = uvs[hit.triangle * 3 + 1];
+        glm::vec2 &c = uvs[hit.triangle * 3 + 2];
 
-    mesh->faces.push_back(face);
+        mesh->uv[i] = a * (1.0f - hit.barycentric.x - hit.barycentric.y) + c * hit.barycentric.x + b * hit.barycentric.y;
+      }
+    });
   }
 };
 
-void VoxelGrid::init() {
-  this->data = new VoxelPtr**[this->gridResolution.x];
+void VoxelGrid::computeError(std::vector<MeshObject> &meshes) {
+  // Every vertex and every triangle center of the LOD is a sample
+  std::vector<glm::vec3> samples;
+
+  for (MeshObject &mesh : meshes) {
+    samples.insert(samples.end(), mesh->position.begin(), mesh->position.end());
 
-  for (unsigned int x = 0; x < (unsigned int) this->gridResolution.x; x++) { 
-    this->data[x] = new VoxelPtr*[this->gridResolution.y];
+    for (Face &face : mesh->faces) {
+      samples.push_back((mesh->position[face.positionIndices[0]] + mesh->position[face.positionIndices[1]] + mesh->position[face.positionIndices[2]]) / 3.0f);
+    }
+  }
 
-    for (unsigned int y = 0; y < (unsigned int) this->gridResolution.y; y++) {
-      this->data[x][y] = new VoxelPtr[this->gridResolution.z];
+  std::vector<float> distances(samples.size(), 0.0f);
 
-      for (unsigned int z = 0; z < (unsigned int) this->gridResolution.z; z++) {
-        this->data[x][y][z] = std::make_shared<Voxel>(glm::ivec3(x, y, z), this->units, this->gridOffset);
+  Scheduler::GetInstance().parallel(TaskClass::Voxelize, samples.size(), 4096, [&](size_t begin, size_t end) {
+    TriangleBVHHit hit;
+
+    for (size_t i = begin; i < end; i++) {
+      if (this->sourceBVH.closestPoint(samples[i], hit)) {
+        distances[i] = hit.distance;
       }
     }
+  });
+
+  // One-sided Hausdorff distance from the LOD to the source, and the RMS of the same distances
+  double squaredSum = 0.0;
+  float maxDistance = 0.0f;
+
+  for (float distance : distances) {
+    squaredSum += (double) distance * (double) distance;
+    maxDistance = std::max(maxDistance, distance);
   }
+
+  this->hausdorffError = maxDistance;
+  this->rmsError = distances.size() > 0 ? (float) std::sqrt(squaredSum / (double) distances.size()) : 0.0f;
+  this->errorSamples = distances.size();
 };
 
-void VoxelGrid::clear() {
-  for (unsigned int x = 0; x < (unsigned int) this->gridResolution.x; x++) {
-    for (unsigned int y = 0; y < (unsigned int) this->gridResolution.y; y++) {
-      for (unsigned int z = 0; z < (unsigned int) this->gridResolution.z; z++) {
-        this->data[x][y][z].reset(new Voxel(glm::ivec3(x, y, z), this->units, this->gridOffset));
-        //this->data[x][y][z] = std::make_shared<Voxel>(glm::ivec3(x, y, z), this->units);
-      }
+void VoxelGrid::bakeTextures(std::vector<MaterialObject> &baked) {
+  TextureBaker baker;
+
+  for (unsigned int m = 0; m < this->passMeshes.size(); m++) {
+    MeshObject &mesh = this->passMeshes[m];
+
+    if (baker.bake(mesh, this->materialBVH[m], this->materialUVs[m], std::max(this->hausdorffError / baker.texelsPerError, this->materialTexelSize[m]))) {
+      baked.push_back(mesh->material);
     }
   }
 };
 
-void VoxelGrid::free() {
-  // Delete each sublevel 
-  for (unsigned int x = 0; x < (unsigned int) this->gridResolution.x; x++) {
-    for (unsigned int y = 0; y < (unsigned int) this->gridResolution.y; y++) {
-      for (unsigned int z = 0; z < (unsigned int) this->gridResolution.z; z++) {
-        this->data[x][y][z].reset();
-      }
+void VoxelGrid::init() {
+  this->free();
 
-      delete[] this->data[x][y];
-    }
+  // A surface crosses about as many bricks as a grid face holds, sized once for the worker
+  unsigned int side = std::max(1, std::max(this->gridResolution.x, this->gridResolution.z) / VOXEL_BRICK_SIZE);
+  this->brickMap.reserve(side * side);
+};
 
-    delete[] this->data[x];
+void VoxelGrid::clear() {
+  // Only the occupied cells are touched, the voxels and the bricks are reused by the next mesh
+  for (unsigned int i = 0; i < this->voxelCount; i++) {
+    glm::ivec3 &position = this->voxels[i].position;
+    this->getBrick(position.x, position.y, position.z)->slots[brickCell(position.x, position.y, position.z)] = 0;
+    this->voxels[i].reset(position);
   }
 
-  delete[] this->data;
+  // Erasing the used keys keeps the reset proportional to the touched bricks, clear() would walk every bucket
+  for (unsigned int i = 0; i < this->brickCount; i++) {
+    glm::ivec3 &origin = this->bricks[i].origin;
+    this->brickMap.erase(brickKey(origin.x, origin.y, origin.z));
+  }
+
+  this->voxelCount = 0;
+  this->brickCount = 0;
+  this->cachedKey = UINT64_MAX;
+  this->activeCells.clear();
+};
+
+void VoxelGrid::free() {
+  std::vector<VoxelBrick>().swap(this->bricks);
+  std::unordered_map<uint64_t, unsigned int>().swap(this->brickMap);
+  this->voxels.clear();
+  this->voxelCount = 0;
+  this->brickCount = 0;
+  this->cachedKey = UINT64_MAX;
+  std::vector<glm::ivec3>().swap(this->activeCells);
+
+  this->releasePass();
+  std::vector<GridRef>().swap(this->slabGrids);
+  this->slabCount = 1;
+};
+
+void VoxelGrid::releasePass() {
+  // The sources can be the whole model for the root LOD, a worker would hold them until its next pass
+  this->sourceBVH = TriangleBVH();
+  std::vector<unsigned int>().swap(this->sourceMaterials);
+  std::vector<VoxelFace>().swap(this->sourceFaces);
+  std::vector<TriangleBVH>().swap(this->materialBVH);
+  std::vector<std::vector<glm::vec2>>().swap(this->materialUVs);
+  std::vector<float>().swap(this->materialTexelSize);
+  std::vector<MeshObject>().swap(this->passMeshes);
 };
\ No newline at end of file
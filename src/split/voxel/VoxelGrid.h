@@ -3,40 +3,150 @@
 
 #include <glm/glm.hpp>
 #include <glm/gtx/rotate_vector.hpp>
+#include <vector>
+#include <deque>
+#include <unordered_map>
+#include <cstdint>
 
 #include "Voxel.h"
+#include "VoxelOctree.h"
+#include "TextureBaker.h"
 #include "./../../helpers/triangleBox.h"
+#include "./../../helpers/triangleBoxSimd.h"
+#include "./../../helpers/gridMath.h"
+#include "./../../helpers/TriangleBVH.h"
+#include "./../../helpers/Scheduler.h"
+
+#define VOXEL_BRICK_BITS 3
+#define VOXEL_BRICK_SIZE (1 << VOXEL_BRICK_BITS)
+#define VOXEL_BRICK_CELLS (VOXEL_BRICK_SIZE * VOXEL_BRICK_SIZE * VOXEL_BRICK_SIZE)
+// Thinnest z-slab of a parallel pass, in cells
+#define VOXEL_SLAB_MIN 16
+
+struct VoxelBrick {
+  glm::ivec3 origin;
+  // Index + 1 of the cell voxel, 0 - the cell is empty
+  unsigned int slots[VOXEL_BRICK_CELLS];
+};
+
+class VoxelGrid;
+typedef std::shared_ptr<VoxelGrid> GridRef;
 
+namespace VoxelMesher {
+  enum Type {
+    MarchingCubes = 0,// up to 5 triangles per cube, a vertex per crossed edge
+    SurfaceNets// a vertex per cube, a quad per crossed edge
+  };
+};
+
+/**
+ * Sparse grid: only 8x8x8 bricks around the surface are allocated, so the memory and the passes
+ * grow with the surface area instead of the grid volume.
+ * A pass is split into z-slabs, each one voxelized and polygonized by its own grid on its own thread.
+ */
 class VoxelGrid {
   public:
-    VoxelPtr*** data;
+    // Bricks in use are the first brickCount, the rest are kept zeroed for reuse
+    std::vector<VoxelBrick> bricks;
+    unsigned int brickCount = 0;
+    std::unordered_map<uint64_t, unsigned int> brickMap;
+
+    // Neighbor lookups mostly stay in the same brick
+    uint64_t cachedKey = UINT64_MAX;
+    unsigned int cachedBrick = 0;
+
+    // Occupied cells, the first voxelCount are in use. A deque keeps the pointers valid while it grows
+    std::deque<Voxel> voxels;
+    unsigned int voxelCount = 0;
+
+    // Occupied cells and the cells whose cube has an occupied corner, sorted in x, y, z order
+    std::vector<glm::ivec3> activeCells;
 
     glm::ivec3 gridResolution = glm::ivec3(64, 64, 64);
     glm::vec3 gridOffset;
     glm::vec3 units;
+    // 1 / units, grid space is (position - gridOffset) * inverseUnits
+    glm::vec3 inverseUnits;
 
     float isoLevel = 1.0f;
     float isoDelta = 0.00001;
 
     glm::vec2 facesBox = glm::vec2(0.0f, 0.0f);
 
+    VoxelMesher::Type mesher = VoxelMesher::MarchingCubes;
+
+    // Cubes of z in [slabBegin, slabEnd) are polygonized by this grid, the layers at slabBegin - 1 and slabEnd are only read
+    int slabBegin = 0;
+    int slabEnd = 0;
+
+    // Grids of the other slabs of a pass, the first slab is this grid
+    std::vector<GridRef> slabGrids;
+    unsigned int slabCount = 1;
+
+    // Occupancy of the whole model built once, the pass takes its cells instead of voxelizing, nullptr - disabled
+    const VoxelOctree* octree = nullptr;
+
+    // Faces of all source meshes of the pass, stored by value and referenced by index from the voxels
+    std::vector<VoxelFace> sourceFaces;
+
+    // Source triangles of the pass, the LOD error is measured against them
+    TriangleBVH sourceBVH;
+    std::vector<unsigned int> sourceMaterials;
+
+    // Source triangles and their corner UVs per material, the LOD vertices take their UVs from them
+    std::vector<TriangleBVH> materialBVH;
+    std::vector<std::vector<glm::vec2>> materialUVs;
+    // World size of a source texel per material, 0 - no texture
+    std::vector<float> materialTexelSize;
+
+    // Meshes of the last pass by material, empty ones included, kept for bakeTextures() only when bake is set
+    std::vector<MeshObject> passMeshes;
+    bool bake = false;
+
+    // Distance from the LOD surface samples to the source of the last pass
+    float hausdorffError = 0.0f;
+    float rmsError = 0.0f;
+    unsigned int errorSamples = 0;
+
     static const unsigned int edgeTable[256];
 	  static const int triTable[256][16];
+    static const int cornerTable[8][3];
+    static const int edgeCorners[12][2];
 
     void init();
     void clear();
     void free();
+    // Drops the sources of the last pass, the grid itself is kept for the next one
+    void releasePass();
+
+    VoxelBrick* getBrick(unsigned int x, unsigned int y, unsigned int z);
+    VoxelBrick* touchBrick(unsigned int x, unsigned int y, unsigned int z);
+    void collectActiveCells();
 
     VoxelPtr get(unsigned int x, unsigned int y, unsigned int z);
+    VoxelPtr touch(unsigned int x, unsigned int y, unsigned int z);
     bool has(unsigned int x, unsigned int y, unsigned int z);
     bool hasTriangles(unsigned int x, unsigned int y, unsigned int z);
     bool triangleIntersectsCell(glm::vec3 a, glm::vec3 b, glm::vec3 c, glm::ivec3 cell);
+    // The triangle is in grid space, see toGridSpace()
+    void overlappingCells(glm::vec3 a, glm::vec3 b, glm::vec3 c, std::vector<glm::ivec3> &cells);
     bool pointInCell(glm::vec3 p, glm::ivec3 cell);
-    void set(VoxelPtr &ptr, unsigned int x, unsigned int y, unsigned int z);
-    void rasterize(GroupObject &src, GroupObject &dest);
-    void voxelize(MeshObject &mesh);
-    void build(MeshObject &mesh, std::map<std::string, MeshObject> &materialMeshMap);
-    void build(VoxelFaceTriangle &triangle, VoxelFaceVertex &vertex, std::vector<LinkedPosition> &list, unsigned int x, unsigned int y, unsigned int z);
+    // Returns the number of source meshes voxelized together in the pass
+    unsigned int rasterize(GroupObject &src, GroupObject &dest);
+    void addFaces(MeshObject &mesh, unsigned int material);
+    void voxelize(const std::vector<VoxelFace> &faces);
+    void fill(std::vector<glm::ivec3> &cells, std::vector<glm::vec3> &normals);
+    void polygonize();
+
+    VoxelGrid* slab(unsigned int index);
+    void prepareSlabs(float depth);
+    void collectTriangles(std::vector<VoxelFaceTriangle*> &triangles);
+    void build(std::vector<MeshObject> &meshes);
+    void assignMaterials();
+    void transferUVs(std::vector<MeshObject> &meshes);
+    void computeError(std::vector<MeshObject> &meshes);
+    // Bakes an atlas for every textured mesh of the last pass, the new materials own their images
+    void bakeTextures(std::vector<MaterialObject> &baked);
 
     bool firstOfX(int cellX, int cellY, int cellZ);
     bool firstOfZ(int cellX, int cellY, int cellZ);
@@ -44,7 +154,9 @@ class VoxelGrid {
     bool lastOfX(int cellX, int cellY, int cellZ);
     bool lastOfZ(int cellX, int cellY, int cellZ);
 
+    void setSpace(glm::vec3 offset, glm::vec3 units);
     glm::ivec3 vecToGrid(float x, float y, float z);
+    void toGridSpace(const glm::vec3* points, glm::vec3* result, size_t count);
     glm::vec3 gridToVec(unsigned int x, unsigned int y, unsigned int z);
 
     float getIntValue(unsigned int x, unsigned int y, unsigned int z);
@@ -57,15 +169,25 @@ class VoxelGrid {
     VoxelPtr getNeighbor(unsigned int x, unsigned int y, unsigned int z, unsigned int index);
 
     glm::vec3 getVoxelVertex(unsigned int x, unsigned int y, unsigned int z, unsigned int index);
-    glm::vec2 getClosestUV(glm::ivec3 voxelPos, glm::vec3 pos);
-
-    void getClosestUV(VoxelFaceTriangle &triangle, glm::ivec3 voxelPos);
-
+    uint64_t getEdgeKey(unsigned int x, unsigned int y, unsigned int z, unsigned int edge);
+    uint64_t getCellKey(unsigned int x, unsigned int y, unsigned int z);
+    unsigned int getCubeIndex(unsigned int x, unsigned int y, unsigned int z);
     glm::vec3 intLinear(glm::vec3 p1, glm::vec3 p2, float valp1, float valp2);
 
     std::vector<VoxelFaceTriangle> getVertices(unsigned int x, unsigned int y, unsigned int z);
+
+    bool getNetVertex(unsigned int x, unsigned int y, unsigned int z, glm::vec3 &position);
+    void getNetFaces(unsigned int x, unsigned int y, unsigned int z);
 };
 
-typedef std::shared_ptr<VoxelGrid> GridRef;
+// Morton order, the bricks of a neighbourhood get close keys
+inline uint64_t brickKey(unsigned int x, unsigned int y, unsigned int z) {
+  return mortonKey(x >> VOXEL_BRICK_BITS, y >> VOXEL_BRICK_BITS, z >> VOXEL_BRICK_BITS);
+};
+
+inline unsigned int brickCell(unsigned int x, unsigned int y, unsigned int z) {
+  const unsigned int mask = VOXEL_BRICK_SIZE - 1;
+  return (((x & mask) << (2 * VOXEL_BRICK_BITS)) | ((y & mask) << VOXEL_BRICK_BITS) | (z & mask));
+};
 
 #endif // __VOXELGRID_H__
\ No newline at end of file
@@ -0,0 +1,196 @@
+#include "VoxelOctree.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "VoxelGrid.h"
+#include "./../../helpers/Scheduler.h"
+
+void VoxelOctree::clear() {
+  std::vector<std::vector<VoxelOctreeCell>>().swap(this->levels);
+  this->depth = 0;
+  this->size = 0.0f;
+};
+
+float VoxelOctree::cellSize(unsigned int level) const {
+  return this->size / (float) (1u << level);
+};
+
+size_t VoxelOctree::cellCount() const {
+  size_t count = 0;
+  for (const std::vector<VoxelOctreeCell> &level : this->levels) {
+    count += level.size();
+  }
+
+  return count;
+};
+
+glm::ivec3 VoxelOctree::toCell(glm::vec3 position, unsigned int level) const {
+  int last = (1 << level) - 1;
+  glm::vec3 cell = glm::floor((position - this->origin) / this->cellSize(level));
+
+  return glm::clamp(glm::ivec3(cell), glm::ivec3(0), glm::ivec3(last));
+};
+
+void VoxelOctree::build(GroupObject &target, unsigned int depth) {
+  this->clear();
+
+  target->computeBoundingBox();
+  BBoxf box = target->boundingBox.clone();
+  glm::vec3 extent = box.getSize();
+
+  std::vector<glm::vec3> corners;
+  target->traverse([&](MeshObject mesh){
+    for (Face &face : mesh->faces) {
+      for (unsigned int i = 0; i < 3; i++) {
+        corners.push_back(mesh->position[face.positionIndices[i]]);
+      }
+    }
+  });
+
+  size_t count = corners.size() / 3;
+  if (count == 0) {
+    return;
+  }
+
+  this->depth = std::min(depth, (unsigned int) VOXEL_OCTREE_MAX_DEPTH);
+  this->origin = box.min;
+  // The root is a cube, a bit wider than the model so that the max side falls inside the last cell
+  this->size = std::max(extent.x, std::max(extent.y, extent.z)) * 1.0001f + 1e-6f;
+
+  // The finest level is voxelized with the same triangle/cell test as a LOD grid
+  VoxelGrid lattice;
+  lattice.gridResolution = glm::ivec3(1 << this->depth);
+  lattice.setSpace(this->origin, glm::vec3(this->cellSize(this->depth)));
+  // The lattice cells are cubes, the normals keep their direction in grid space
+  lattice.toGridSpace(corners.data(), corners.data(), corners.size());
+
+  const size_t chunk = 4096;
+  std::vector<std::vector<VoxelOctreeCell>> parts((count + chunk - 1) / chunk);
+
+  Scheduler::GetInstance().parallel(TaskClass::Voxelize, count, chunk, [&](size_t begin, size_t end) {
+    std::vector<VoxelOctreeCell> &part = parts[begin / chunk];
+    std::vector<glm::ivec3> cells;
+
+    for (size_t i = begin; i < end; i++) {
+      glm::vec3 &a = corners[i * 3];
+      glm::vec3 &b = corners[i * 3 + 1];
+      glm::vec3 &c = corners[i * 3 + 2];
+
+      glm::vec3 normal = glm::cross(b - a, c - a);
+      if (glm::length(normal) > 0.0f) {
+        normal = glm::normalize(normal);
+      }
+
+      lattice.overlappingCells(a, b, c, cells);
+
+      for (glm::ivec3 &cell : cells) {
+        VoxelOctreeCell octreeCell;
+        octreeCell.key = mortonKey(cell.x, cell.y, cell.z);
+        octreeCell.normal = normal;
+        octreeCell.faces = 1;
+
+        part.push_back(octreeCell);
+      }
+    }
+  });
+
+  corners = std::vector<glm::vec3>();
+
+  std::vector<VoxelOctreeCell> finest;
+  for (std::vector<VoxelOctreeCell> &part : parts) {
+    finest.insert(finest.end(), part.begin(), part.end());
+    part = std::vector<VoxelOctreeCell>();
+  }
+
+  std::sort(finest.begin(), finest.end(), [](const VoxelOctreeCell &a, const VoxelOctreeCell &b) {
+    return a.key < b.key;
+  });
+
+  this->levels.resize(this->depth + 1);
+
+  // Every coarser level merges the runs of equal parent keys, the arrays stay sorted
+  std::vector<VoxelOctreeCell>* source = &finest;
+  unsigned int shift = 0;
+
+  for (int level = this->depth; level >= 0; level--) {
+    std::vector<VoxelOctreeCell> &cells = this->levels[level];
+
+    for (VoxelOctreeCell &cell : *source) {
+      uint64_t key = cell.key >> shift;
+
+      if (!cells.empty() && cells.back().key == key) {
+        cells.back().normal += cell.normal;
+        cells.back().faces += cell.faces;
+      } else {
+        VoxelOctreeCell parent = cell;
+        parent.key = key;
+        cells.push_back(parent);
+      }
+    }
+
+    cells.shrink_to_fit();
+
+    source = &cells;
+    shift = 3;
+  }
+};
+
+unsigned int VoxelOctree::fit(BBoxf box, glm::ivec3 resolution, glm::ivec3 &minCell, glm::ivec3 &maxCell) const {
+  for (int level = this->depth; level > 0; level--) {
+    minCell = this->toCell(box.min, level);
+    maxCell = this->toCell(box.max, level);
+
+    glm::ivec3 span = maxCell - minCell + glm::ivec3(1);
+    if (span.x <= resolution.x && span.y <= resolution.y && span.z <= resolution.z) {
+      return level;
+    }
+  }
+
+  minCell = glm::ivec3(0);
+  maxCell = glm::ivec3(0);
+
+  return 0;
+};
+
+void VoxelOctree::collect(unsigned int level, glm::ivec3 minCell, glm::ivec3 maxCell, std::vector<glm::ivec3> &cells, std::vector<glm::vec3> &normals) const {
+  cells.clear();
+  normals.clear();
+
+  if (this->levels.size() <= level || this->levels[0].empty()) {
+    return;
+  }
+
+  // Top-down walk, only the branches overlapping the box are opened
+  std::vector<std::pair<unsigned int, size_t>> stack = { std::make_pair(0u, (size_t) 0) };
+
+  while (!stack.empty()) {
+    unsigned int current = stack.back().first;
+    const VoxelOctreeCell &cell = this->levels[current][stack.back().second];
+    stack.pop_back();
+
+    glm::ivec3 position = mortonCell(cell.key);
+    unsigned int shift = level - current;
+
+    if (glm::any(glm::lessThan(position, minCell >> (int) shift)) || glm::any(glm::greaterThan(position, maxCell >> (int) shift))) {
+      continue;
+    }
+
+    if (current == level) {
+      cells.push_back(position - minCell);
+      normals.push_back(glm::length(cell.normal) > 0.0f ? glm::normalize(cell.normal) : cell.normal);
+      continue;
+    }
+
+    const std::vector<VoxelOctreeCell> &children = this->levels[current + 1];
+    uint64_t firstChild = cell.key << 3;
+
+    std::vector<VoxelOctreeCell>::const_iterator it = std::lower_bound(children.begin(), children.end(), firstChild, [](const VoxelOctreeCell &child, uint64_t key) {
+      return child.key < key;
+    });
+
+    for (; it != children.end() && (it->key >> 3) == cell.key; ++it) {
+      stack.push_back(std::make_pair(current + 1, (size_t) (it - children.begin())));
+    }
+  }
+};
@@ -0,0 +1,54 @@
+#ifndef __VOXELOCTREE_H__
+#define __VOXELOCTREE_H__
+
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+
+#include "./../../loaders/Loader.h"
+#include "./../../helpers/gridMath.h"
+
+// Morton keys hold 21 bits per axis
+#define VOXEL_OCTREE_MAX_DEPTH 20
+
+struct VoxelOctreeCell {
+  // Morton key of the cell within its level
+  uint64_t key = 0;
+  // Sum of the normals of the faces crossing the cell
+  glm::vec3 normal = glm::vec3(0.0f);
+  unsigned int faces = 0;
+};
+
+/**
+ * Sparse occupancy octree of a whole model, voxelized once at the finest level.
+ * Every level is a sorted array of Morton keys, a parent is the key of its children shifted by 3 bits.
+ * A LOD grid takes the cells of the level that fits its box instead of voxelizing its triangles again.
+ */
+class VoxelOctree {
+  public:
+    // Minimum corner and side of the root cube
+    glm::vec3 origin;
+    float size = 0.0f;
+    unsigned int depth = 0;
+
+    // From the root at 0 to the finest level at depth
+    std::vector<std::vector<VoxelOctreeCell>> levels;
+
+    void build(GroupObject &target, unsigned int depth);
+    void clear();
+
+    float cellSize(unsigned int level) const;
+    size_t cellCount() const;
+
+    // Finest level where the cells of the box span no more than the resolution
+    unsigned int fit(BBoxf box, glm::ivec3 resolution, glm::ivec3 &minCell, glm::ivec3 &maxCell) const;
+    // Occupied cells of the level within [minCell, maxCell], relative to minCell
+    void collect(unsigned int level, glm::ivec3 minCell, glm::ivec3 maxCell, std::vector<glm::ivec3> &cells, std::vector<glm::vec3> &normals) const;
+
+  private:
+    glm::ivec3 toCell(glm::vec3 position, unsigned int level) const;
+};
+
+typedef std::shared_ptr<VoxelOctree> OctreeRef;
+
+#endif // __VOXELOCTREE_H__
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <vector>
+#include <cstdint>
 #include <glm/glm.hpp>
 
 #include "./../../loaders/Loader.h"
@@ -11,7 +12,7 @@ struct VoxelFaceVertex {
   glm::vec3 position;
   glm::vec3 normal;
   glm::vec2 uv;
-  int index = -1;// Assume that we have a constant grid with less than (MAX_INT / 36) cells count
+  uint64_t edge = 0;// Grid edge of a marching cubes vertex, the same for every triangle that shares it
 };
 
 struct VoxelFaceTriangle {
@@ -19,6 +20,7 @@ struct VoxelFaceTriangle {
   VoxelFaceVertex b;
   VoxelFaceVertex c;
   glm::vec3 normal;
+  unsigned int material = 0;// Index of the source mesh of the closest face
 
   VoxelFaceVertex& operator[] (size_t i);
 };
@@ -38,20 +40,21 @@ struct VoxelFaceQuad {
   VoxelFaceTriangle t2;
 };
 
-struct LinkedPosition {
-  VoxelFaceVertex vertex;
-  std::vector<VoxelFaceTriangle> linkedTriangles;
-};
-
 struct VoxelFace {
   VoxelFaceVertex vertices[3];
-  std::string materialName;
+  // Positions in grid space of the pass, converted once when the face is added
+  glm::vec3 grid[3];
+  unsigned int material = 0;// Index of the source mesh within the rasterized group
+  glm::vec3 normal;
+
+  // Grid layers the face can touch, z-slabs skip the faces out of their range
+  int minZ = 0;
+  int maxZ = 0;
 
   bool hasNormals = false;
   bool hasUVs = false;
 };
 
-typedef std::shared_ptr<VoxelFace> VoxelFacePtr;
 
 struct VoxelBox {
   glm::vec3 min;
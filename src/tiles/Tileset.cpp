@@ -4,6 +4,7 @@ Tileset::Tileset(IdGenerator::ID rootId) {
   this->root = std::make_shared<Tile>();
   this->root->id = rootId;
   this->root->refine = TileRefine::REPLASE;
+  this->tiles[rootId] = this->root;
 
   /*
   this->root->transform = glm::mat4(
@@ -74,11 +75,23 @@ void Tileset::computeRootBoundingVolume() {
 };
 
 std::shared_ptr<Tile> Tileset::findTileById(IdGenerator::ID id) {
-  if (this->root->id == id) {
-    return this->root;
+  std::unordered_map<IdGenerator::ID, std::shared_ptr<Tile>>::iterator it = this->tiles.find(id);
+  if (it == this->tiles.end()) {
+    return NULL;
   }
 
-  return this->root->findTileById(id);
+  return it->second;
+};
+
+std::shared_ptr<Tile> Tileset::getTile(IdGenerator::ID id) {
+  std::shared_ptr<Tile> &tile = this->tiles[id];
+
+  if (tile == NULL) {
+    tile = std::make_shared<Tile>();
+    tile->id = id;
+  }
+
+  return tile;
 };
 
 nlohmann::json Tileset::toJSON() {
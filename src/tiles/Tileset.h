@@ -3,6 +3,7 @@
 
 #include <functional>
 #include <memory>
+#include <unordered_map>
 
 #include <json/json.hpp>
 
@@ -26,7 +27,13 @@ class Tileset {
     void computeRootBoundingVolume();
     std::shared_ptr<Tile> search(Tile::TileSearchCallback fn);
     std::shared_ptr<Tile> findTileById(IdGenerator::ID id);
+    // Creates the tile when it is not known yet, a child can be saved before its parent
+    std::shared_ptr<Tile> getTile(IdGenerator::ID id);
     nlohmann::json toJSON();
+
+  private:
+    // Every tile by its id, including the ones not linked to the root yet
+    std::unordered_map<IdGenerator::ID, std::shared_ptr<Tile>> tiles;
 };
 
 #endif // __TILESET_H__
\ No newline at end of file
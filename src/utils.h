@@ -4,6 +4,7 @@
 #include <algorithm>
 #include <regex>
 #include <string>
+#include <cstring>
 #include <sstream>
 #include <iostream>
 #include <sys/stat.h>